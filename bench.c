@@ -0,0 +1,266 @@
+/**
+ * @file bench.c
+ * @brief Micro-benchmarks of the board kernels over a matrix of board sizes,
+ * densities and versions. Every kernel is first checked against B_update,
+ * then timed after a warmup; the median and 99th percentile of the
+ * repetitions are reported as CSV.
+ */
+#include <board.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <packed.h>
+#include <simd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WARMUP (2)           /**< Untimed iterations before the timed ones */
+#define REPETITIONS (15)     /**< Default number of timed iterations */
+#define MAX_SIDE (16384)     /**< Default largest side of the boards */
+#define PRINT_MAX_SIDE (1024) /**< Largest side for which B_print is timed */
+#define TIME_BUDGET (2.0)    /**< Seconds after which repetitions stop early */
+
+/** State shared by the kernels for one board of the matrix */
+typedef struct {
+  Board *initial;      /**< Random board every kernel starts from */
+  Board *board;        /**< Board stepped by the byte kernels */
+  Board *result;       /**< Receives the output of the packed kernels */
+  PackedBoard *packed; /**< Board stepped by the packed kernels */
+  ThreadPool *pool;    /**< Threads of B_step_parallel */
+  int density;         /**< Probability in percent of a cell being alive */
+  unsigned long long seed; /**< Seed used by the generators */
+} Case;
+
+/** A benchmarked kernel */
+typedef struct {
+  const char *name;              /**< Name in the report */
+  const char *simd;              /**< Kernels of PB_step, NULL otherwise */
+  void (*prepare)(Case *c);      /**< Restores the initial board */
+  void (*run)(Case *c);          /**< One timed iteration */
+  Board *(*output)(Case *c);     /**< Generation reached, NULL if unchecked */
+} Kernel;
+
+/**
+ * Returns a monotonic time stamp
+ * @return Time in seconds
+ */
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Compares the cell values of two boards. If equal returns 1.
+ * @param b1 First board
+ * @param b2 Second board
+ */
+static int board_compare(Board *b1, Board *b2) {
+  return b1->height == b2->height && b1->width == b2->width &&
+         memcmp(b1->cells, b2->cells,
+                (size_t)b1->height * b1->width * sizeof(Cell)) == 0;
+}
+
+/** Copies the initial board into the byte board */
+static void prepare_board(Case *c) {
+  B_track_activity(c->board, 0);
+  memcpy(c->board->cells, c->initial->cells,
+         (size_t)c->initial->height * c->initial->width * sizeof(Cell));
+  c->board->dirty = 1;
+}
+
+/** Copies the initial board into the byte board and tracks its tiles */
+static void prepare_tiles(Case *c) {
+  prepare_board(c);
+  B_track_activity(c->board, 1);
+}
+
+/** Packs the initial board */
+static void prepare_packed(Case *c) {
+  if (c->packed != NULL)
+    PB_destroy(c->packed);
+  c->packed = PB_from_board(c->initial);
+}
+
+/** Steps with the allocating B_update */
+static void run_update(Case *c) {
+  Board *next = B_update(c->board);
+  B_destroy(c->board);
+  c->board = next;
+}
+
+/** Steps in place */
+static void run_step(Case *c) { B_step(c->board); }
+
+/** Steps in place on every thread of the pool */
+static void run_parallel(Case *c) { B_step_parallel(c->board, c->pool); }
+
+/** Steps the packed board */
+static void run_packed(Case *c) { PB_step(c->packed); }
+
+/** Fills the board with new random cells */
+static void run_generate(Case *c) {
+  B_generate(c->board, c->density, c->seed++);
+}
+
+/** Fills the packed board with new random cells */
+static void run_packed_generate(Case *c) {
+  PB_generate(c->packed, c->density, c->seed++, NULL);
+}
+
+/** Prints the board, with the standard output sent to /dev/null */
+static void run_print(Case *c) {
+  int null = open("/dev/null", O_WRONLY);
+  int out = dup(STDOUT_FILENO);
+  fflush(stdout);
+  dup2(null, STDOUT_FILENO);
+  B_print(c->board);
+  fflush(stdout);
+  dup2(out, STDOUT_FILENO);
+  close(out);
+  close(null);
+}
+
+/** Generation reached by the byte kernels */
+static Board *output_board(Case *c) { return c->board; }
+
+/** Generation reached by the packed kernels */
+static Board *output_packed(Case *c) {
+  return PB_to_board(c->packed, c->result);
+}
+
+/** Every benchmarked kernel, B_update being the reference */
+static const Kernel kernels[] = {
+    {"B_update", NULL, prepare_board, run_update, output_board},
+    {"B_step", NULL, prepare_board, run_step, output_board},
+    {"B_step_parallel", NULL, prepare_board, run_parallel, output_board},
+    {"B_step_tiles", NULL, prepare_tiles, run_step, output_board},
+    {"PB_step_avx2", "avx2", prepare_packed, run_packed, output_packed},
+    {"PB_step_sse2", "sse2", prepare_packed, run_packed, output_packed},
+    {"PB_step_scalar", "scalar", prepare_packed, run_packed, output_packed},
+    {"B_generate", NULL, prepare_board, run_generate, NULL},
+    {"PB_generate", NULL, prepare_packed, run_packed_generate, NULL},
+    {"B_print", NULL, prepare_board, run_print, NULL},
+};
+
+/**
+ * Compares two durations for qsort
+ * @return Negative, zero or positive like strcmp
+ */
+static int compare_times(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Checks and times one kernel on one board of the matrix and prints its line
+ * of the report
+ * @param kernel Pointer to the kernel
+ * @param c Pointer to the state of the board
+ * @param reference The initial board after one B_update
+ * @param repetitions Maximum number of timed iterations
+ * @return 1 if the kernel gave the same generation as the reference
+ */
+static int bench_kernel(const Kernel *kernel, Case *c, Board *reference,
+                        int repetitions) {
+  double times[REPETITIONS * 16];
+  const char *check = "n/a";
+  int ok = 1, n = 0;
+
+  if (kernel->simd != NULL && !PB_select_kernel(kernel->simd))
+    return 1;
+
+  if (kernel->output != NULL) {
+    kernel->prepare(c);
+    kernel->run(c);
+    ok = board_compare(kernel->output(c), reference);
+    check = ok ? "ok" : "MISMATCH";
+  }
+
+  kernel->prepare(c);
+  for (int k = 0; k < WARMUP; k++)
+    kernel->run(c);
+  double budget = now() + TIME_BUDGET;
+  while (n < repetitions && (n < 3 || now() < budget)) {
+    double start = now();
+    kernel->run(c);
+    times[n++] = now() - start;
+  }
+  qsort(times, n, sizeof(double), compare_times);
+
+  double median = times[n / 2];
+  double p99 = times[(99 * n + 99) / 100 - 1];
+  double cells = (double)c->initial->height * c->initial->width;
+  printf("%s,%s,%d,%d,%d,%.4f,%.4f,%.1f,%s\n", kernel->name,
+         c->initial->version == CIRCULAR ? "circular" : "clipped",
+         c->initial->width, c->density, n, median * 1e3, p99 * 1e3,
+         cells / median * 1e-6, check);
+  fflush(stdout);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  int max_side = MAX_SIDE, repetitions = REPETITIONS;
+  int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int densities[] = {10, 33, 50};
+  Version versions[] = {CLIPPED, CIRCULAR};
+  int opt, failures = 0;
+
+  while ((opt = getopt(argc, argv, "m:r:j:")) != -1) {
+    switch (opt) {
+    case 'm':
+      max_side = atoi(optarg);
+      break;
+    case 'r':
+      repetitions = atoi(optarg);
+      break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-m <max side>] [-r <repetitions>] "
+                      "[-j <threads>]\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (repetitions < 1 || repetitions > REPETITIONS * 16)
+    repetitions = REPETITIONS;
+
+  const char *best = PB_kernel_name();
+  Case c = {NULL, NULL, NULL, NULL, TP_new(threads), 0, 1};
+  printf("kernel,version,side,density,repetitions,median_ms,p99_ms,"
+         "mcells_per_s,check\n");
+
+  for (int side = 64; side <= max_side; side *= 4) {
+    for (int v = 0; v < 2; v++) {
+      for (int d = 0; d < 3; d++) {
+        c.density = densities[d];
+        c.initial = B_generate(B_new(side, side, versions[v]), c.density, 1);
+        c.board = B_new(side, side, versions[v]);
+        c.result = B_new(side, side, versions[v]);
+        Board *reference = B_update(c.initial);
+
+        int count = (int)(sizeof(kernels) / sizeof(kernels[0]));
+        for (int k = 0; k < count; k++) {
+          if (kernels[k].run == run_print && side > PRINT_MAX_SIDE)
+            continue;
+          failures += !bench_kernel(&kernels[k], &c, reference, repetitions);
+        }
+        PB_select_kernel(best);
+
+        B_destroy(reference);
+        B_destroy(c.initial);
+        B_destroy(c.board);
+        B_destroy(c.result);
+        if (c.packed != NULL)
+          PB_destroy(c.packed);
+        c.packed = NULL;
+      }
+    }
+  }
+  TP_destroy(c.pool);
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
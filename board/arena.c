@@ -0,0 +1,136 @@
+/**
+ * @file arena.c
+ * @brief Contains the arena of same-sized boards. B_update takes its new
+ * board from the arena of the old one and gives the old one back, so once
+ * the arena holds two boards a chain of updates makes no heap calls.
+ */
+#include <arena.h>
+#include <stdlib.h>
+
+/**
+ * Makes room for one more board in the arena
+ * @param arena Pointer to the arena
+ */
+static void _grow(BoardArena *arena) {
+  if (arena->count < arena->size)
+    return;
+  int size = arena->size > 0 ? 2 * arena->size : 2;
+  Board **boards = (Board **)realloc(arena->boards, size * sizeof(Board *));
+  if (boards != NULL)
+    arena->boards = boards;
+  Board **spare = (Board **)realloc(arena->spare, size * sizeof(Board *));
+  if (boards == NULL || spare == NULL) {
+    printf("AR_take: Could not allocate %d boards\nExiting...\n", size);
+    exit(1);
+  }
+  arena->spare = spare;
+  arena->size = size;
+}
+
+/**
+ * Makes a new board of the arena
+ * @param arena Pointer to the arena
+ * @return Pointer to the board, in use
+ */
+static Board *_make(BoardArena *arena) {
+  _grow(arena);
+  Board *board = B_new(arena->height, arena->width, arena->version);
+  board->arena = arena;
+  arena->boards[arena->count++] = board;
+  return board;
+}
+
+/**
+ * Creates an arena of boards of one size, with some boards made at once
+ * @param height Height of the boards
+ * @param width Width of the boards
+ * @param version Version of the boards
+ * @param count Number of boards made at once, 2 for a chain of B_update
+ * @return Pointer to the arena
+ */
+BoardArena *AR_new(int height, int width, Version version, int count) {
+  BoardArena *arena = (BoardArena *)calloc(1, sizeof(BoardArena));
+  if (arena == NULL) {
+    printf("AR_new: Could not allocate the arena\nExiting...\n");
+    exit(1);
+  }
+  arena->height = height;
+  arena->width = width;
+  arena->version = version;
+  for (int k = 0; k < count; k++) {
+    Board *board = _make(arena);
+    arena->spare[arena->spares++] = board;
+  }
+  return arena;
+}
+
+/**
+ * Takes a board from the arena, making a new one only when none is spare.
+ * The board goes back to the arena with B_destroy or AR_release.
+ * @param arena Pointer to the arena
+ * @param reset 1 to get a board with dead cells and the default rule, 0 to
+ * leave the cells and the rule of its last use, for callers writing every
+ * cell anyway
+ * @return Pointer to the board
+ */
+Board *AR_take(BoardArena *arena, int reset) {
+  if (arena->spares > 0) {
+    Board *board = arena->spare[--arena->spares];
+    if (reset) {
+      Rule rule;
+      RU_make(&rule, 1 << 3, (1 << 2) | (1 << 3), 2);
+      B_reset(B_set_rule(board, &rule));
+    }
+    return board;
+  }
+  return _make(arena);
+}
+
+/**
+ * Gives a board back to the arena. Activity tracking is turned off and the
+ * statistics collector is forgotten.
+ * @param arena Pointer to the arena
+ * @param board Pointer to a board taken from this arena
+ */
+void AR_release(BoardArena *arena, Board *board) {
+  if (board == NULL || board->arena != arena) {
+    printf("AR_release: Board does not belong to the arena\nExiting...\n");
+    exit(1);
+  }
+  if (board->tile_rows > 0)
+    B_track_activity(board, 0);
+  board->stats = NULL;
+  arena->spare[arena->spares++] = board;
+}
+
+/**
+ * Counts the boards taken from the arena and not given back
+ * @param arena Pointer to the arena
+ * @return Number of boards in use
+ */
+int AR_outstanding(BoardArena *arena) { return arena->count - arena->spares; }
+
+/**
+ * Frees the arena and its spare boards. Boards still in use are reported on
+ * the standard error in debug builds and are left to the caller: they are
+ * detached from the arena, so a later B_destroy frees them.
+ * @param arena Pointer to the arena
+ */
+void AR_destroy(BoardArena *arena) {
+  if (arena == NULL) {
+    printf("AR_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+#ifndef NDEBUG
+  if (AR_outstanding(arena) > 0)
+    fprintf(stderr, "AR_destroy: %d of %d %dx%d boards not given back\n",
+            AR_outstanding(arena), arena->count, arena->height, arena->width);
+#endif
+  for (int k = 0; k < arena->count; k++)
+    arena->boards[k]->arena = NULL;
+  for (int k = 0; k < arena->spares; k++)
+    B_destroy(arena->spare[k]);
+  free(arena->boards);
+  free(arena->spare);
+  free(arena);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file arena.h
+ * @brief Header file for the arena of same-sized boards that B_update draws
+ * its new boards from and returns the old ones to
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <board.h>
+
+/** Boards of one size kept for reuse. Boards drawn from the arena go back to
+ * it with B_destroy or when B_update replaces them, so a chain of updates
+ * keeps reusing the same few boards. The arena is owned by the caller and
+ * is not shared between threads. */
+typedef struct BoardArena {
+  int height;      /**< Height of every board */
+  int width;       /**< Width of every board */
+  Version version; /**< Version of every board */
+  Board **boards;  /**< Every board of the arena, in use or not */
+  Board **spare;   /**< Stack of the boards not in use */
+  int count;       /**< Number of boards of the arena */
+  int spares;      /**< Number of boards not in use */
+  int size;        /**< Capacity of boards and spare */
+} BoardArena;
+
+BoardArena *AR_new(int height, int width, Version version, int count);
+Board *AR_take(BoardArena *arena, int reset);
+void AR_release(BoardArena *arena, Board *board);
+int AR_outstanding(BoardArena *arena);
+void AR_destroy(BoardArena *arena);
+#endif
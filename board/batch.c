@@ -0,0 +1,176 @@
+/**
+ * @file batch.c
+ * @brief Contains the batch runner. Random boards stabilize after very
+ * different numbers of generations, so the threads do not get fixed shares:
+ * each one claims the next board of the block as soon as it is done with
+ * the previous one, reusing its own board and cycle detector.
+ */
+#include <batch.h>
+#include <cycle.h>
+#include <random.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Seed of the draw of the seeds of the boards */
+#define BA_SEED (0xBA7C4ULL)
+
+/** Arguments of the run of one block of boards */
+typedef struct {
+  const BatchSpec *spec;  /**< Boards of the batch */
+  long long first;        /**< Index of the first board of the block */
+  long long count;        /**< Number of boards of the block */
+  atomic_llong next;      /**< Offset of the next board to claim */
+  Board **boards;         /**< Board of every thread */
+  CycleDetector **cycles; /**< Cycle detector of every thread */
+  BatchResult *results;   /**< Result of every board of the block */
+} BatchTask;
+
+/**
+ * Fills a batch specification with the B3/S23 rule
+ * @param spec Pointer to the specification
+ * @param height Height of every board
+ * @param width Width of every board
+ * @param version CLIPPED or CIRCULAR
+ * @param density Probability in percent of a cell being alive
+ * @param seed Seed the seeds of the boards are drawn from
+ * @param generations Largest number of generations of a board
+ * @return Pointer to the specification
+ */
+BatchSpec *BA_spec(BatchSpec *spec, int height, int width, Version version,
+                   int density, unsigned long long seed,
+                   long long generations) {
+  spec->height = height;
+  spec->width = width;
+  spec->version = version;
+  RU_make(&spec->rule, 1 << 3, (1 << 2) | (1 << 3), 2);
+  spec->density = density;
+  spec->seed = seed;
+  spec->generations = generations;
+  return spec;
+}
+
+/**
+ * Returns the seed of a board of the batch, so that it can be generated
+ * again alone
+ * @param spec Pointer to the specification of the batch
+ * @param index Number of the board
+ * @return Seed given to B_generate
+ */
+unsigned long long BA_seed(const BatchSpec *spec, long long index) {
+  return R_random(spec->seed ^ BA_SEED, (uint64_t)index);
+}
+
+/**
+ * Counts the alive cells of a board
+ * @param board Pointer to the struct Board
+ * @return Population
+ */
+static long long _population(Board *board) {
+  long long count = 0;
+  for (size_t k = 0; k < (size_t)board->height * board->width; k++)
+    count += B_is_alive(board->cells[k]);
+  return count;
+}
+
+/**
+ * Generates a board and steps it until it is in a cycle or the largest
+ * number of generations is reached
+ * @param spec Pointer to the specification of the batch
+ * @param board Board of the calling thread
+ * @param detector Cycle detector of the calling thread
+ * @param index Number of the board
+ * @param result Receives the statistics of the board
+ */
+static void _run_board(const BatchSpec *spec, Board *board,
+                       CycleDetector *detector, long long index,
+                       BatchResult *result) {
+  result->index = index;
+  result->seed = BA_seed(spec, index);
+  B_generate(board, spec->density, result->seed);
+  result->initial = _population(board);
+  result->start = -1;
+  result->period = 0;
+  detector->generation = 0;
+  CD_reset(detector, board);
+
+  long long t = 0;
+  while (t < spec->generations) {
+    B_step(board);
+    t++;
+    if (CD_observe(detector, board)) {
+      result->start = detector->start;
+      result->period = detector->period;
+      break;
+    }
+  }
+  result->generations = t;
+  result->population = _population(board);
+}
+
+/**
+ * Task of the thread pool running boards of the block until none is left
+ * @param arg Pointer to the BatchTask
+ * @param band Index of the calling thread
+ * @param bands Number of threads, unused: the boards are claimed through a
+ * shared counter
+ */
+static void _run_band(void *arg, int band, int bands) {
+  BatchTask *task = (BatchTask *)arg;
+  long long k;
+  (void)bands;
+  while ((k = atomic_fetch_add(&task->next, 1)) < task->count)
+    _run_board(task->spec, task->boards[band], task->cycles[band],
+               task->first + k, &task->results[k]);
+}
+
+/**
+ * Steps the given number of random boards of the specification, each one
+ * until it is in a cycle or the largest number of generations is reached,
+ * and hands their results to the sink. Results come block by block, in the
+ * order of the boards, while the threads of the pool go through the boards
+ * of the block.
+ * @param spec Pointer to the specification of the batch
+ * @param boards Number of boards
+ * @param pool Pointer to the thread pool, NULL to use the calling thread
+ * @param sink Receives the result of every board
+ * @param target Argument of the sink
+ */
+void BA_run(const BatchSpec *spec, long long boards, ThreadPool *pool,
+            BA_Sink sink, void *target) {
+  int threads = TP_threads(pool);
+  BatchTask task;
+  task.spec = spec;
+  task.boards = (Board **)malloc(threads * sizeof(Board *));
+  task.cycles = (CycleDetector **)malloc(threads * sizeof(CycleDetector *));
+  task.results = (BatchResult *)malloc(BA_BLOCK * sizeof(BatchResult));
+  if (task.boards == NULL || task.cycles == NULL || task.results == NULL) {
+    printf("BA_run: Could not allocate the batch\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < threads; k++) {
+    task.boards[k] = B_set_rule(
+        B_new(spec->height, spec->width, spec->version), &spec->rule);
+    task.cycles[k] = CD_new(task.boards[k]);
+  }
+
+  for (task.first = 0; task.first < boards; task.first += BA_BLOCK) {
+    task.count = boards - task.first < BA_BLOCK ? boards - task.first
+                                                : BA_BLOCK;
+    atomic_init(&task.next, 0);
+    if (pool != NULL)
+      TP_run(pool, _run_band, &task);
+    else
+      _run_band(&task, 0, 1);
+    for (long long k = 0; k < task.count; k++)
+      sink(target, &task.results[k]);
+  }
+
+  for (int k = 0; k < threads; k++) {
+    CD_destroy(task.cycles[k]);
+    B_destroy(task.boards[k]);
+  }
+  free(task.boards);
+  free(task.cycles);
+  free(task.results);
+}
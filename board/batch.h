@@ -0,0 +1,47 @@
+/**
+ * @file batch.h
+ * @brief Header file for the batch runner stepping many small random boards
+ * to stabilization on a thread pool and reporting one result per board
+ */
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <board.h>
+#include <pool.h>
+#include <stdint.h>
+
+/** Number of boards whose results are gathered before being handed out */
+#define BA_BLOCK (1024)
+
+/** Boards of a batch, which only differ by their seed */
+typedef struct {
+  int height;              /**< Height of every board */
+  int width;               /**< Width of every board */
+  Version version;         /**< CLIPPED or CIRCULAR */
+  Rule rule;               /**< Rule of every board */
+  int density;             /**< Probability in percent of a cell being alive */
+  unsigned long long seed; /**< Seed the seeds of the boards are drawn from */
+  long long generations;   /**< Largest number of generations of a board */
+} BatchSpec;
+
+/** Statistics of one board of a batch */
+typedef struct {
+  long long index;         /**< Number of the board in the batch */
+  unsigned long long seed; /**< Seed generating the board with B_generate */
+  long long initial;       /**< Population of generation 0 */
+  long long population;    /**< Population of the last generation stepped */
+  long long generations;   /**< Number of generations stepped */
+  long long start;         /**< First generation of the cycle, -1 if none */
+  long long period;        /**< Period of the cycle, 0 if none was found */
+} BatchResult;
+
+/** Receives the results of a batch, in the order of the boards */
+typedef void (*BA_Sink)(void *target, const BatchResult *result);
+
+BatchSpec *BA_spec(BatchSpec *spec, int height, int width, Version version,
+                   int density, unsigned long long seed,
+                   long long generations);
+unsigned long long BA_seed(const BatchSpec *spec, long long index);
+void BA_run(const BatchSpec *spec, long long boards, ThreadPool *pool,
+            BA_Sink sink, void *target);
+#endif
@@ -3,54 +3,904 @@
  * @brief Contains functions related to interactions with the Board
  */
 #include <ansi.h>
+#include <arena.h>
 #include <board.h>
+#include <random.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+#include <unistd.h>
+
+static void _select_kernel(Board *board);
+/**
+ * Rounds the size of one generation up to a multiple of B_ALIGNMENT so the
+ * back buffer that follows it in the same block stays aligned too.
+ * @param height Heigth of the board
+ * @param width Width of the board
+ * @return Size in bytes of one generation buffer
+ */
+static size_t _generation_size(int height, int width) {
+  size_t size = (size_t)height * (size_t)width * sizeof(Cell);
+  return (size + B_ALIGNMENT - 1) / B_ALIGNMENT * B_ALIGNMENT;
+}
+
 /**
- * Creates new reset (all cells are dead) board
+ * Points the given row pointers into a contiguous generation buffer
+ * @param rows Array of height row pointers
+ * @param cells Contiguous buffer of height * width cells
+ * @param height Heigth of the board
+ * @param width Width of the board
+ */
+static void _set_rows(Cell **rows, Cell *cells, int height, int width) {
+  for (int i = 0; i < height; i++)
+    rows[i] = cells + (size_t)i * width;
+}
+
+/**
+ * Creates new reset (all cells are dead) board. Both generations are stored in
+ * a single aligned allocation so that stepping never has to allocate.
  * @param height Heigth of the board
  * @param width Width of the board
  * @return Pointer to the board structure
  */
 Board *B_new(int height, int width, Version version) {
+  size_t size = _generation_size(height, width);
   Board *board = (Board *)malloc(sizeof(Board));
+  Cell *block = (Cell *)aligned_alloc(B_ALIGNMENT, 2 * size);
+  Cell **rows = (Cell **)malloc(2 * (size_t)height * sizeof(Cell *));
+  if (board == NULL || block == NULL || rows == NULL) {
+    printf("B_new: Could not allocate %dx%d board\nExiting...\n", height,
+           width);
+    exit(1);
+  }
   board->height = height;
   board->width = width;
   board->version = version;
-  board->cell = (Cell **)malloc(height * sizeof(Cell *));
-  for (int i = 0; i < height; i++) {
-    board->cell[i] = (Cell *)malloc(width * sizeof(Cell));
-  }
+  board->cells = block;
+  board->next = (Cell *)((char *)block + size);
+  board->cell = rows;
+  board->next_cell = rows + height;
+  _set_rows(board->cell, board->cells, height, width);
+  _set_rows(board->next_cell, board->next, height, width);
+  board->tile_rows = 0;
+  board->tile_cols = 0;
+  board->changed = NULL;
+  board->active = NULL;
+  board->active_tiles = 0;
+  RU_make(&board->rule, 1 << 3, (1 << 2) | (1 << 3), 2);
+  board->stats = NULL;
+  board->arena = NULL;
+  _select_kernel(board);
   return B_reset(board);
 }
 
 /**
- * Updates the board to the next time unit t + 1
+ * Counts a cell in the column sums
+ * @param c The cell
+ * @param dying 1 if the rule has dying states, which are not counted
+ * @return 1 if the cell is alive, 0 otherwise
+ */
+static inline unsigned char _count(Cell c, int dying) {
+  return (unsigned char)(dying ? c == ALIVE : c);
+}
+
+/**
+ * Sums every column of the three rows around a row over columns
+ * [begin - 1, end + 1), wrapping or clipping the two outer columns according
+ * to the version. Inlined with constant flags, so the two state rules keep
+ * adding the cells themselves and the rows inside the board do not check
+ * for missing neighbours.
+ * @param width Width of the board
+ * @param up Row above, NULL if it is outside of a CLIPPED board
+ * @param mid Row being computed
+ * @param down Row below, NULL if it is outside of a CLIPPED board
+ * @param sums Receives the sum of column begin - 1 + k at index k
+ * @param begin First column of the chunk
+ * @param end Column after the last one of the chunk
+ * @param circular 1 if the board is CIRCULAR
+ * @param dying 1 if the rule has dying states
+ * @param full 1 if neither up nor down is NULL
+ */
+static inline void _column_sums(int width, const Cell *up, const Cell *mid,
+                                const Cell *down, unsigned char *sums,
+                                int begin, int end, int circular, int dying,
+                                int full) {
+  int first = begin > 0 ? begin - 1 : begin;
+  int last = end < width ? end + 1 : end;
+  unsigned char *out = sums + (first - (begin - 1));
+
+  if (full) {
+    for (int j = first; j < last; j++)
+      *out++ = (unsigned char)(_count(up[j], dying) + _count(mid[j], dying) +
+                               _count(down[j], dying));
+  } else {
+    for (int j = first; j < last; j++)
+      *out++ = (unsigned char)((up != NULL ? _count(up[j], dying) : 0) +
+                               _count(mid[j], dying) +
+                               (down != NULL ? _count(down[j], dying) : 0));
+  }
+
+  // Columns outside of the board wrap around or count as dead
+  if (begin == 0)
+    sums[0] =
+        circular
+            ? (unsigned char)((up != NULL ? _count(up[width - 1], dying) : 0) +
+                              _count(mid[width - 1], dying) +
+                              (down != NULL ? _count(down[width - 1], dying)
+                                            : 0))
+            : 0;
+  if (end == width)
+    sums[end - begin + 1] =
+        circular ? (unsigned char)((up != NULL ? _count(up[0], dying) : 0) +
+                                   _count(mid[0], dying) +
+                                   (down != NULL ? _count(down[0], dying) : 0))
+                 : 0;
+}
+
+/**
+ * Adds the counts of a part of a row to the statistics of a step, and the
+ * part to the bounding box if it has alive cells
+ * @param part Statistics of the cells computed so far, top being -1 while
+ * none is alive
+ * @param after The row in the next generation
+ * @param row Number of the row
+ * @param begin First column of the part
+ * @param end Column after the last one of the part
+ * @param alive Number of alive cells of the part
+ * @param births Number of cells of the part born by the step
+ * @param deaths Number of cells of the part that died in the step
+ */
+static void _part_stats(Stats *part, const Cell *after, int row, int begin,
+                        int end, int alive, int births, int deaths) {
+  int first = begin, last = end - 1;
+  part->population += alive;
+  part->births += births;
+  part->deaths += deaths;
+  if (alive == 0)
+    return;
+  while (after[first] != ALIVE)
+    first++;
+  while (after[last] != ALIVE)
+    last--;
+  if (part->top < 0) {
+    part->top = part->bottom = row;
+    part->left = first;
+    part->right = last;
+    return;
+  }
+  part->top = row < part->top ? row : part->top;
+  part->bottom = row > part->bottom ? row : part->bottom;
+  part->left = first < part->left ? first : part->left;
+  part->right = last > part->right ? last : part->right;
+}
+
+/**
+ * Looks the next state of the cells of a chunk up in the rule. Inlined with
+ * a constant part, so the counts only cost when statistics are gathered; they
+ * are then taken by a loop without branches, which the compiler vectorizes.
+ * @param rule Transition table of the rule
+ * @param sums Column sums of the chunk, see _column_sums
+ * @param mid The row in the current generation
+ * @param out The row in the next generation
+ * @param begin First column of the chunk
+ * @param end Column after the last one of the chunk
+ * @param part Receives the counts of the chunk, NULL for none
+ * @param row Number of the row
+ * @return Non zero if any cell of the chunk changed
+ */
+static inline int _apply_rule(const unsigned char (*rule)[10],
+                              const unsigned char *sums, const Cell *mid,
+                              Cell *out, int begin, int end, Stats *part,
+                              int row) {
+  int changed = 0, alive = 0, births = 0, deaths = 0;
+  for (int j = begin; j < end; j++) {
+    int k = j - begin + 1;
+    int population = sums[k - 1] + sums[k] + sums[k + 1];
+    // The population counts an alive cell itself, see Rule
+    out[j] = (Cell)rule[mid[j]][population];
+    changed |= out[j] ^ mid[j];
+  }
+  if (part != NULL) {
+    for (int j = begin; j < end; j++) {
+      int now = out[j] == ALIVE, was = mid[j] == ALIVE;
+      alive += now;
+      births += now & ~was;
+      deaths += was & ~now;
+    }
+    _part_stats(part, out, row, begin, end, alive, births, deaths);
+  }
+  return changed;
+}
+
+/**
+ * Computes columns [col_begin, col_end) of a row of the next generation,
+ * chunk by chunk
+ * @param rule Transition table of the rule
+ * @param up Row above, NULL if it is outside of a CLIPPED board
+ * @param mid Row being computed
+ * @param down Row below, NULL if it is outside of a CLIPPED board
+ * @param out The row in the next generation
+ * @param row Number of the row
+ * @param col_begin First column to compute
+ * @param col_end Column after the last one to compute
+ * @param width Width of the board
+ * @param circular 1 if the board is CIRCULAR
+ * @param dying 1 if the rule has dying states
+ * @param full 1 if neither up nor down is NULL
+ * @param part Receives the statistics of the row, NULL for none
+ * @param timing 1 to measure the time of the phases of every chunk into part,
+ * which costs three clock readings per chunk: _region only asks it for one
+ * row
+ * @return Non zero if any cell of the row changed
+ */
+static inline int _next_row(const unsigned char (*rule)[10], const Cell *up,
+                            const Cell *mid, const Cell *down, Cell *out,
+                            int row, int col_begin, int col_end, int width,
+                            int circular, int dying, int full, Stats *part,
+                            int timing) {
+  unsigned char sums[B_CHUNK + 2];
+  double clock = 0;
+  int changed = 0;
+
+  for (int j0 = col_begin; j0 < col_end; j0 += B_CHUNK) {
+    int j1 = j0 + B_CHUNK < col_end ? j0 + B_CHUNK : col_end;
+    if (timing)
+      clock = ST_now();
+    _column_sums(width, up, mid, down, sums, j0, j1, circular, dying, full);
+    if (timing) {
+      part->seconds[ST_COUNT] -= clock;
+      clock = ST_now();
+      part->seconds[ST_COUNT] += clock;
+    }
+    if (part != NULL)
+      changed |= _apply_rule(rule, sums, mid, out, j0, j1, part, row);
+    else
+      changed |= _apply_rule(rule, sums, mid, out, j0, j1, NULL, row);
+    if (timing)
+      part->seconds[ST_RULE] += ST_now() - clock;
+  }
+  return changed;
+}
+
+/**
+ * Computes rows [begin, end) and columns [col_begin, col_end) of the
+ * generation following the current one of the board in a single pass. Each
+ * row is handled from a sliding window of the rows above and below it: their
+ * column sums are taken over a chunk of at most B_CHUNK columns and three
+ * neighbouring sums give the 3x3 population, so no neighbour count is stored
+ * for the whole board. The rule turns the state of the cell and that
+ * population into the next state with a single table lookup. When the board
+ * collects statistics, the cells of every chunk are counted while they are
+ * still in the cache and the counts are added once for the whole region.
+ * When it also times the phases, the region is timed as a whole and one of
+ * its rows, timed phase by phase, splits that time between counting and the
+ * rule, so the clock is read a few times per region rather than per chunk.
+ * Inlined into the kernels with a constant version, rule kind and width:
+ * the first and last rows of the board are the only ones whose neighbours
+ * wrap around or are missing, the others go through a loop without any
+ * check, and a constant width lets the compiler unroll whole rows.
+ * @param board Pointer to the struct Board holding the current generation
+ * @param next Contiguous buffer of height * width cells receiving the result
+ * @param begin First row to compute
+ * @param end Row after the last one to compute
+ * @param col_begin First column to compute
+ * @param col_end Column after the last one to compute
+ * @param circular 1 if the board is CIRCULAR
+ * @param dying 1 if the rule has dying states
+ * @param fixed Width of the board, 0 to read it from the board
+ * @return 1 if any computed cell differs from the current generation
+ */
+static inline int _region(Board *board, Cell *next, int begin, int end,
+                          int col_begin, int col_end, int circular, int dying,
+                          int fixed) {
+  int height = board->height;
+  int width = fixed ? fixed : board->width;
+  const unsigned char(*rule)[10] = board->rule.next;
+  const Cell *cells = board->cells;
+  StatsCollector *stats = board->stats;
+  int timing = stats != NULL && stats->timing;
+  Stats part = {0}, *counts = stats != NULL ? &part : NULL;
+  int changed = 0;
+  part.top = -1;
+  // The row timed phase by phase, an inner one unless the region has none
+  int first = begin > 1 ? begin : 1;
+  int last = end < height - 1 ? end : height - 1;
+  int sample = timing ? (first < last ? first : begin) : -1;
+  double start = timing ? ST_now() : 0;
+
+  // Rows on the edges of the board, whose neighbours wrap around or miss
+  for (int e = 0; e < (height > 1 ? 2 : 1); e++) {
+    int i = e == 0 ? 0 : height - 1;
+    if (i < begin || i >= end)
+      continue;
+    const Cell *mid = cells + (size_t)i * width;
+    const Cell *up = i > 0 ? mid - width
+                     : circular ? cells + (size_t)(height - 1) * width
+                                : NULL;
+    const Cell *down = i < height - 1 ? mid + width : circular ? cells : NULL;
+    changed |= _next_row(rule, up, mid, down, next + (size_t)i * width, i,
+                         col_begin, col_end, width, circular, dying, 0,
+                         counts, i == sample);
+  }
+
+  // Rows inside of the board, whole rows with a constant width if it is one
+  int whole = fixed && col_begin == 0 && col_end == fixed;
+  for (int i = first; i < last; i++) {
+    const Cell *mid = cells + (size_t)i * width;
+    Cell *out = next + (size_t)i * width;
+    if (whole)
+      changed |= _next_row(rule, mid - width, mid, mid + width, out, i, 0,
+                           fixed, width, circular, dying, 1, counts,
+                           i == sample);
+    else
+      changed |= _next_row(rule, mid - width, mid, mid + width, out, i,
+                           col_begin, col_end, width, circular, dying, 1,
+                           counts, i == sample);
+  }
+  if (timing) {
+    double total = ST_now() - start;
+    double sampled = part.seconds[ST_COUNT] + part.seconds[ST_RULE];
+    double count = sampled > 0 ? part.seconds[ST_COUNT] / sampled : 1;
+    part.seconds[ST_COUNT] = total * count;
+    part.seconds[ST_RULE] = total - part.seconds[ST_COUNT];
+  }
+  if (stats != NULL)
+    ST_add(stats, &part);
+  return changed != 0;
+}
+
+/** Defines a kernel computing a region like _region with constant flags */
+#define B_KERNEL(name, circular, dying, fixed)                                 \
+  static int name(Board *board, Cell *next, int begin, int end,                \
+                  int col_begin, int col_end) {                                \
+    return _region(board, next, begin, end, col_begin, col_end, circular,      \
+                   dying, fixed);                                              \
+  }
+
+B_KERNEL(_clipped, 0, 0, 0)
+B_KERNEL(_clipped_10, 0, 0, 10)
+B_KERNEL(_clipped_50, 0, 0, 50)
+B_KERNEL(_circular, 1, 0, 0)
+B_KERNEL(_circular_10, 1, 0, 10)
+B_KERNEL(_circular_50, 1, 0, 50)
+B_KERNEL(_clipped_dying, 0, 1, 0)
+B_KERNEL(_clipped_dying_10, 0, 1, 10)
+B_KERNEL(_clipped_dying_50, 0, 1, 50)
+B_KERNEL(_circular_dying, 1, 1, 0)
+B_KERNEL(_circular_dying_10, 1, 1, 10)
+B_KERNEL(_circular_dying_50, 1, 1, 50)
+
+/** Kernel computing a region of the next generation, see _region */
+typedef struct {
+  const char *name; /**< Name of the kernel, e.g. "circular-50" */
+  int circular;     /**< 1 for CIRCULAR boards */
+  int dying;        /**< 1 for rules with dying states */
+  int width;        /**< Width of the boards, 0 for any */
+  /** Computes rows [begin, end) and columns [col_begin, col_end) */
+  int (*region)(Board *board, Cell *next, int begin, int end, int col_begin,
+                int col_end);
+} Kernel;
+
+/** Every kernel, the ones of a fixed width before the general one */
+static const Kernel kernels[] = {
+    {"clipped-10", 0, 0, 10, _clipped_10},
+    {"clipped-50", 0, 0, 50, _clipped_50},
+    {"clipped", 0, 0, 0, _clipped},
+    {"circular-10", 1, 0, 10, _circular_10},
+    {"circular-50", 1, 0, 50, _circular_50},
+    {"circular", 1, 0, 0, _circular},
+    {"clipped-dying-10", 0, 1, 10, _clipped_dying_10},
+    {"clipped-dying-50", 0, 1, 50, _clipped_dying_50},
+    {"clipped-dying", 0, 1, 0, _clipped_dying},
+    {"circular-dying-10", 1, 1, 10, _circular_dying_10},
+    {"circular-dying-50", 1, 1, 50, _circular_dying_50},
+    {"circular-dying", 1, 1, 0, _circular_dying},
+};
+
+/** Number of entries in kernels */
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/**
+ * Chooses the kernel of the board from its version, its rule and its width.
+ * Called whenever one of them changes, so the steps never check them.
+ * @param board Pointer to the struct Board
+ */
+static void _select_kernel(Board *board) {
+  int circular = board->version == CIRCULAR;
+  int dying = board->rule.states > 2;
+  for (int k = 0; k < KERNEL_COUNT; k++)
+    if (kernels[k].circular == circular && kernels[k].dying == dying &&
+        (kernels[k].width == 0 || kernels[k].width == board->width)) {
+      board->kernel = k;
+      return;
+    }
+}
+
+/**
+ * Computes rows [begin, end) and columns [col_begin, col_end) of the
+ * generation following the current one with the kernel of the board
+ * @param board Pointer to the struct Board holding the current generation
+ * @param next Contiguous buffer of height * width cells receiving the result
+ * @param begin First row to compute
+ * @param end Row after the last one to compute
+ * @param col_begin First column to compute
+ * @param col_end Column after the last one to compute
+ * @return 1 if any computed cell differs from the current generation
+ */
+static int _next_region(Board *board, Cell *next, int begin, int end,
+                        int col_begin, int col_end) {
+  return kernels[board->kernel].region(board, next, begin, end, col_begin,
+                                       col_end);
+}
+
+/**
+ * Returns the name of the kernel stepping the board
+ * @param board Pointer to the struct Board
+ * @return Name of the kernel, e.g. "circular-50"
+ */
+const char *B_kernel_name(Board *board) { return kernels[board->kernel].name; }
+
+/**
+ * Computes rows [begin, end) of the generation following the current one
+ * @param board Pointer to the struct Board holding the current generation
+ * @param next Contiguous buffer of height * width cells receiving the result
+ * @param begin First row to compute
+ * @param end Row after the last one to compute
+ */
+static void _next_rows(Board *board, Cell *next, int begin, int end) {
+  _next_region(board, next, begin, end, 0, board->width);
+}
+
+/**
+ * Computes the active tiles among the tile rows [begin, end) and records
+ * which of them changed. An inactive tile and its neighbours did not change
+ * during the previous step, so both buffers already hold the same cells for
+ * it and the back buffer needs no write at all.
+ * @param board Pointer to the struct Board holding the current generation
+ * @param begin First row of tiles
+ * @param end Row of tiles after the last one
+ */
+static void _next_tiles(Board *board, int begin, int end) {
+  for (int ti = begin; ti < end; ti++) {
+    for (int tj = 0; tj < board->tile_cols; tj++) {
+      int t = ti * board->tile_cols + tj;
+      int row = ti * B_TILE, col = tj * B_TILE;
+      int row_end = row + B_TILE < board->height ? row + B_TILE : board->height;
+      int col_end = col + B_TILE < board->width ? col + B_TILE : board->width;
+      if (!board->active[t]) {
+        board->changed[t] = 0;
+        // The cells of a quiet tile still count in the statistics
+        if (board->stats != NULL) {
+          Stats part = {0};
+          part.top = -1;
+          for (int i = row; i < row_end; i++) {
+            int alive = 0;
+            for (int j = col; j < col_end; j++)
+              alive += board->cell[i][j] == ALIVE;
+            _part_stats(&part, board->cell[i], i, col, col_end, alive, 0, 0);
+          }
+          ST_add(board->stats, &part);
+        }
+        continue;
+      }
+      board->changed[t] =
+          (unsigned char)_next_region(board, board->next, row, row_end, col,
+                                      col_end);
+    }
+  }
+}
+
+/**
+ * Marks the tiles that have to be computed in the coming step: every tile
+ * when cells were written from outside, otherwise the ones that changed during
+ * the last step and their neighbours
+ * @param board Pointer to the struct Board
+ */
+static void _mark_active(Board *board) {
+  int rows = board->tile_rows, cols = board->tile_cols;
+  int circular = board->version == CIRCULAR;
+
+  board->active_tiles = 0;
+  for (int ti = 0; ti < rows; ti++) {
+    for (int tj = 0; tj < cols; tj++) {
+      int active = board->dirty;
+      for (int di = -1; di <= 1 && !active; di++) {
+        for (int dj = -1; dj <= 1 && !active; dj++) {
+          int ni = ti + di, nj = tj + dj;
+          if (circular) {
+            ni = (ni + rows) % rows;
+            nj = (nj + cols) % cols;
+          } else if (ni < 0 || nj < 0 || ni >= rows || nj >= cols) {
+            continue;
+          }
+          active = board->changed[ni * cols + nj];
+        }
+      }
+      board->active[ti * cols + tj] = (unsigned char)active;
+      board->active_tiles += active;
+    }
+  }
+  board->dirty = 0;
+}
+
+/**
+ * Makes the back buffer of the board its current generation
+ * @param board Pointer to the struct Board
+ */
+static void _swap_generations(Board *board) {
+  Cell *cells = board->cells;
+  Cell **rows = board->cell;
+
+  board->cells = board->next;
+  board->cell = board->next_cell;
+  board->next = cells;
+  board->next_cell = rows;
+}
+
+/**
+ * Task of the thread pool computing one row band of the next generation
+ * @param arg Pointer to the struct Board
+ * @param band Index of the band computed by the calling thread
+ * @param bands Number of bands the board is split into
+ */
+static void _next_band(void *arg, int band, int bands) {
+  Board *board = (Board *)arg;
+  // With activity tracking the bands are made of whole rows of tiles
+  int rows = board->tile_rows > 0 ? board->tile_rows : board->height;
+  int begin = (int)((long long)rows * band / bands);
+  int end = (int)((long long)rows * (band + 1) / bands);
+  if (board->tile_rows > 0)
+    _next_tiles(board, begin, end);
+  else
+    _next_rows(board, board->next, begin, end);
+}
+
+/**
+ * Updates the board to the next time unit t + 1. A board taken from an arena
+ * gets its new board from the same arena and is given back to it, so
+ * board = B_update(board) neither leaks nor allocates once the arena holds
+ * two boards. A board allocated on its own is left to the caller.
  * @param board Pointer to the struct Board to be updated
  * @return Pointer to the new struct Board with updated cell values
  */
 Board *B_update(Board *board) {
-  int alive_neighbours[board->height][board->width];
-  Board *new_board = B_new(board->height, board->width, board->version);
+  StatsCollector *stats = board->stats;
+  double start = stats != NULL && stats->timing ? ST_now() : 0;
+  if (stats != NULL)
+    ST_begin(stats);
+  Board *new_board =
+      board->arena != NULL
+          ? AR_take(board->arena, 0)
+          : B_new(board->height, board->width, board->version);
+  new_board->rule = board->rule;
+  new_board->kernel = board->kernel;
+  new_board->stats = stats;
+  new_board->dirty = 1;
+  if (stats != NULL && stats->timing)
+    ST_time(stats, ST_ALLOC, ST_now() - start);
+  _next_rows(board, new_board->cells, 0, board->height);
+  if (board->arena != NULL)
+    AR_release(board->arena, board);
+  if (stats != NULL)
+    ST_end(stats);
+  return new_board;
+}
 
-  for (int i = 0; i < board->height; i++) {
-    for (int j = 0; j < board->width; j++) {
-      alive_neighbours[i][j] = _count_alive_neighbours(board, i, j);
-    }
+/**
+ * Updates the board in place to the next time unit t + 1. The next generation
+ * is written into the preallocated back buffer which then becomes the current
+ * one, so steady-state stepping does not allocate.
+ * @param board Pointer to the struct Board to be updated
+ * @return The same pointer to the struct Board
+ */
+Board *B_step(Board *board) {
+  if (board->stats != NULL)
+    ST_begin(board->stats);
+  if (board->tile_rows > 0) {
+    _mark_active(board);
+    _next_tiles(board, 0, board->tile_rows);
+  } else {
+    _next_rows(board, board->next, 0, board->height);
   }
-  for (int i = 0; i < board->height; i++) {
-    for (int j = 0; j < board->width; j++) {
-      // Dead cell becomes alive if it has 3 alive neighbours
-      if (alive_neighbours[i][j] == 3)
-        B_set_alive(new_board, i, j);
-      // Alive cell is still alive if it has 2 alive neighbours
-      else if (alive_neighbours[i][j] == 2 && B_is_alive(board->cell[i][j]))
-        B_set_alive(new_board, i, j);
-      else
-        B_set_dead(new_board, i, j);
+  _swap_generations(board);
+  if (board->stats != NULL)
+    ST_end(board->stats);
+  return board;
+}
+
+/**
+ * Computes rows [begin, end) of the next generation into the back buffer,
+ * without making it current. Steps can thus be split, for instance to
+ * compute the rows that do not depend on cells received from elsewhere
+ * first. Activity tracking has to be off.
+ * @param board Pointer to the struct Board
+ * @param begin First row to compute
+ * @param end Row after the last one to compute
+ * @return Pointer to the struct Board
+ */
+Board *B_next_rows(Board *board, int begin, int end) {
+  if (begin < end)
+    _next_rows(board, board->next, begin, end);
+  return board;
+}
+
+/**
+ * Makes the back buffer filled by B_next_rows the current generation
+ * @param board Pointer to the struct Board
+ * @return Pointer to the struct Board
+ */
+Board *B_swap(Board *board) {
+  _swap_generations(board);
+  return board;
+}
+
+/**
+ * Updates the board in place to the next time unit t + 1 using every thread
+ * of the pool. The board is split into one row band per thread; each band only
+ * reads the current generation and writes its own rows of the back buffer, so
+ * the result is the same as the one of B_step.
+ * @param board Pointer to the struct Board to be updated
+ * @param pool Pointer to the thread pool, NULL to step on the calling thread
+ * @return The same pointer to the struct Board
+ */
+Board *B_step_parallel(Board *board, ThreadPool *pool) {
+  if (pool == NULL)
+    return B_step(board);
+  if (board->stats != NULL)
+    ST_begin(board->stats);
+  if (board->tile_rows > 0)
+    _mark_active(board);
+  TP_run(pool, _next_band, board);
+  _swap_generations(board);
+  if (board->stats != NULL)
+    ST_end(board->stats);
+  return board;
+}
+
+/** Arguments of one pass of temporally blocked stepping */
+typedef struct {
+  Board *board;   /**< Board being stepped */
+  Board **locals; /**< Board of every thread holding a tile and its halo */
+  int tile;       /**< Side in cells of the tiles written back */
+  int depth;      /**< Number of generations of the pass */
+} BlockTask;
+
+/**
+ * Copies rows [row, row + height) and columns [col, col + width) of the
+ * current generation of the board into the current generation of a local
+ * board, wrapping around the edges
+ * @param board Pointer to the struct Board
+ * @param local Pointer to the local board, at least height x width
+ * @param row First row, may be out of a CIRCULAR board
+ * @param col First column, may be out of a CIRCULAR board
+ * @param height Number of rows
+ * @param width Number of columns
+ */
+static void _load_block(Board *board, Board *local, int row, int col,
+                        int height, int width) {
+  local->height = height;
+  local->width = width;
+  _select_kernel(local);
+  for (int i = 0; i < height; i++) {
+    const Cell *src = board->cells +
+                      (size_t)(((row + i) % board->height + board->height) %
+                               board->height) *
+                          board->width;
+    Cell *dst = local->cells + (size_t)i * width;
+    for (int j = 0; j < width;) {
+      int from = ((col + j) % board->width + board->width) % board->width;
+      int count = board->width - from < width - j ? board->width - from
+                                                  : width - j;
+      memcpy(dst + j, src + from, (size_t)count * sizeof(Cell));
+      j += count;
     }
   }
-  return new_board;
+}
+
+/**
+ * Steps one tile of the board by the depth of the pass into the back buffer.
+ * The tile is loaded with a halo of depth cells on every side and the local
+ * board is stepped in place, the area of valid cells shrinking by one cell
+ * per generation on the sides cut out of the board. Sides on the edge of a
+ * CLIPPED board stay edges, so they do not shrink.
+ * @param task Pointer to the BlockTask
+ * @param local Local board of the calling thread
+ * @param row First row of the tile
+ * @param col First column of the tile
+ */
+static void _next_block(BlockTask *task, Board *local, int row, int col) {
+  Board *board = task->board;
+  int depth = task->depth, circular = board->version == CIRCULAR;
+  int rows = board->height - row < task->tile ? board->height - row
+                                              : task->tile;
+  int cols = board->width - col < task->tile ? board->width - col : task->tile;
+  int top = row - depth, left = col - depth;
+  int bottom = row + rows + depth, right = col + cols + depth;
+  if (!circular) {
+    top = top > 0 ? top : 0;
+    left = left > 0 ? left : 0;
+    bottom = bottom < board->height ? bottom : board->height;
+    right = right < board->width ? right : board->width;
+  }
+  int fixed_top = !circular && top == 0;
+  int fixed_left = !circular && left == 0;
+  int fixed_bottom = !circular && bottom == board->height;
+  int fixed_right = !circular && right == board->width;
+  int height = bottom - top, width = right - left;
+
+  _load_block(board, local, top, left, height, width);
+  for (int g = 1; g <= depth; g++) {
+    _next_region(local, local->next, fixed_top ? 0 : g,
+                 fixed_bottom ? height : height - g, fixed_left ? 0 : g,
+                 fixed_right ? width : width - g);
+    _swap_generations(local);
+  }
+  for (int i = 0; i < rows; i++)
+    memcpy(board->next + (size_t)(row + i) * board->width + col,
+           local->cells + (size_t)(row - top + i) * width + (col - left),
+           (size_t)cols * sizeof(Cell));
+}
+
+/**
+ * Task of the thread pool stepping the tiles of one band of tile rows
+ * @param arg Pointer to the BlockTask
+ * @param band Index of the band computed by the calling thread
+ * @param bands Number of bands the board is split into
+ */
+static void _next_block_band(void *arg, int band, int bands) {
+  BlockTask *task = (BlockTask *)arg;
+  Board *board = task->board;
+  int rows = (board->height + task->tile - 1) / task->tile;
+  int begin = (int)((long long)rows * band / bands);
+  int end = (int)((long long)rows * (band + 1) / bands);
+  for (int ti = begin; ti < end; ti++)
+    for (int col = 0; col < board->width; col += task->tile)
+      _next_block(task, task->locals[band], ti * task->tile, col);
+}
+
+/**
+ * Chooses the shape of the temporal blocks from the size of the L2 cache:
+ * both generations of a tile with its halo fit in it, and the halo is kept
+ * thin enough that the cells computed twice by neighbouring tiles stay a
+ * small part of the work
+ * @param tile Receives the side in cells of the tiles
+ * @param depth Receives the number of generations per pass over the board
+ */
+void B_block_shape(int *tile, int *depth) {
+  long cache = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  if (cache <= 0)
+    cache = B_BLOCK_CACHE;
+  int side = 16;
+  while ((long)(side + 1) * (side + 1) * 2 * (long)sizeof(Cell) <= cache)
+    side++;
+  *depth = side / 16 > 1 ? side / 16 : 1;
+  *tile = side - 2 * *depth;
+}
+
+/**
+ * Steps the board by the given number of generations with temporal blocking:
+ * each pass loads a tile with a halo of depth cells into a small board that
+ * stays in the cache, steps it depth generations there and writes the tile
+ * back once, so the board goes through memory once per depth generations
+ * instead of once per generation. Tiles only read the current generation and
+ * write their own cells of the back buffer, so the threads of the pool step
+ * bands of them and the result is the one of as many B_step.
+ * @param board Pointer to the struct Board to be updated
+ * @param generations Number of generations
+ * @param tile Side in cells of the tiles
+ * @param depth Largest number of generations of a pass
+ * @param pool Pointer to the thread pool, NULL to step on the calling thread
+ * @return The same pointer to the struct Board
+ */
+Board *B_step_blocked(Board *board, long long generations, int tile,
+                      int depth, ThreadPool *pool) {
+  // Tracked tiles already skip the quiet areas, one generation at a time, and
+  // the statistics are the ones of every generation
+  if (board->tile_rows > 0 || board->stats != NULL) {
+    for (long long t = 0; t < generations; t++)
+      B_step_parallel(board, pool);
+    return board;
+  }
+  int threads = TP_threads(pool);
+  int side = tile + 2 * depth;
+  BlockTask task = {board, (Board **)malloc(threads * sizeof(Board *)), tile,
+                    depth};
+  if (task.locals == NULL) {
+    printf("B_step_blocked: Could not allocate the tiles\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < threads; k++)
+    task.locals[k] = B_set_rule(B_new(side, side, CLIPPED), &board->rule);
+
+  for (long long t = 0; t < generations; t += task.depth) {
+    task.depth = generations - t < depth ? (int)(generations - t) : depth;
+    if (pool != NULL)
+      TP_run(pool, _next_block_band, &task);
+    else
+      _next_block_band(&task, 0, 1);
+    _swap_generations(board);
+  }
+
+  for (int k = 0; k < threads; k++)
+    B_destroy(task.locals[k]);
+  free(task.locals);
+  board->dirty = 1;
+  return board;
+}
+
+/**
+ * Steps the board by the given number of generations, with temporal blocking
+ * shaped by B_block_shape when the board does not fit in the cache anyway
+ * @param board Pointer to the struct Board to be updated
+ * @param generations Number of generations
+ * @param pool Pointer to the thread pool, NULL to step on the calling thread
+ * @return The same pointer to the struct Board
+ */
+Board *B_step_n(Board *board, long long generations, ThreadPool *pool) {
+  int tile, depth;
+  B_block_shape(&tile, &depth);
+  if ((long long)board->height * board->width <= (long long)tile * tile) {
+    for (long long t = 0; t < generations; t++)
+      B_step_parallel(board, pool);
+    return board;
+  }
+  return B_step_blocked(board, generations, tile, depth, pool);
+}
+
+/**
+ * Turns tracking of the active tiles on or off. With tracking, B_step and
+ * B_step_parallel only compute the B_TILE x B_TILE tiles that changed during
+ * the last step or border one that did, so the cost of a step follows the
+ * activity on the board rather than its area.
+ * @param board Pointer to the struct Board
+ * @param enable 1 to track the active tiles, 0 to compute every cell
+ */
+void B_track_activity(Board *board, int enable) {
+  free(board->changed);
+  board->changed = NULL;
+  board->active = NULL;
+  board->tile_rows = 0;
+  board->tile_cols = 0;
+  board->active_tiles = 0;
+  if (!enable)
+    return;
+
+  int rows = (board->height + B_TILE - 1) / B_TILE;
+  int cols = (board->width + B_TILE - 1) / B_TILE;
+  board->changed = (unsigned char *)calloc(2 * (size_t)rows * cols, 1);
+  if (board->changed == NULL) {
+    printf("B_track_activity: Could not allocate tiles\nExiting...\n");
+    exit(1);
+  }
+  board->active = board->changed + (size_t)rows * cols;
+  board->tile_rows = rows;
+  board->tile_cols = cols;
+  board->dirty = 1;
+}
+
+/**
+ * Makes the steps of the board gather their statistics into a collector.
+ * The counts are taken inside the update pass, the phases are only timed
+ * when the collector asks for it.
+ * @param board Pointer to the struct Board
+ * @param stats Pointer to the collector, NULL to stop gathering
+ */
+void B_collect_stats(Board *board, StatsCollector *stats) {
+  board->stats = stats;
+}
+
+/**
+ * Returns the number of tiles computed during the last step
+ * @param board Pointer to the struct Board
+ * @return Number of active tiles, or of all tiles without tracking
+ */
+int B_active_tiles(Board *board) {
+  if (board->tile_rows == 0)
+    return ((board->height + B_TILE - 1) / B_TILE) *
+           ((board->width + B_TILE - 1) / B_TILE);
+  return board->active_tiles;
 }
 
 /**
@@ -59,80 +909,27 @@ Board *B_update(Board *board) {
  * @return poitner to Board structure with reset cells (all cells are DEAD)
  */
 Board *B_reset(Board *board) {
-  for (int i = 0; i < board->height; i++)
-    for (int j = 0; j < board->width; j++)
-      B_set_dead(board, i, j);
+  for (size_t k = 0; k < (size_t)board->height * board->width; k++)
+    board->cells[k] = DEAD;
+  board->dirty = 1;
   return board;
 }
 
 /**
- * Counts the alive cells that are neighbouring with provided cell
- * @param board Pointer to the Board structure
- * @param i The row (x) coordinate of the cell
- * @param j The column (y) coordinate of the cell
- * @return The number of alive neighbouring cells
+ * Changes the rule applied by the next steps of the board. Cells in states
+ * the new rule does not have are made dead.
+ * @param board Pointer to the struct Board
+ * @param rule Pointer to the rule, copied into the board
+ * @return Pointer to the struct Board
  */
-static int _count_alive_neighbours(Board *board, int i, int j) {
-  int height = board->height;
-  int width = board->width;
-  int count = 0;
-
-  // List of neighbours of the given cell
-
-  if (board->version == CIRCULAR) {
-    if (i == 0)
-      i = height;
-    if (j == 0)
-      j = width;
-    Cell neighbours_circle[] = {board->cell[i - 1][j - 1],
-                                board->cell[i - 1][j % width],
-                                board->cell[i - 1][(j + 1) % width],
-                                board->cell[i % height][j - 1],
-                                board->cell[i % height][(j + 1) % width],
-                                board->cell[(i + 1) % height][j - 1],
-                                board->cell[(i + 1) % height][j % width],
-                                board->cell[(i + 1) % height][(j + 1) % width]};
-
-    // We consider that the grid is infinite
-    // If we check the border cell, we need to check the opposite edge too.
-
-    // Iterate through the neighbours and count alive ones
-    for (int k = 0; k < 8; k++) {
-      if (B_is_alive(neighbours_circle[k]))
-        count++;
-    }
-  } else if (board->version == CLIPPED) {
-    // CLIPPED version
-    if (i != 0) {
-      if (j != 0)
-        if (B_is_alive(board->cell[i - 1][j - 1]))
-          count++;
-      if (B_is_alive(board->cell[i - 1][j]))
-        count++;
-      if (j != width - 1)
-        if (B_is_alive(board->cell[i - 1][j + 1]))
-          count++;
-    }
-    if (j != 0)
-      if (board->cell[i][j - 1])
-        count++;
-    if (j != width - 1)
-      if (B_is_alive(board->cell[i][j + 1]))
-        count++;
-
-    if (i != height - 1) {
-      if (j != 0)
-        if (B_is_alive(board->cell[i + 1][j - 1]))
-          count++;
-
-      if (B_is_alive(board->cell[i + 1][j]))
-        count++;
-      if (j != width - 1)
-        if (B_is_alive(board->cell[i + 1][j + 1]))
-          count++;
-    }
-  }
-  return count;
+Board *B_set_rule(Board *board, const Rule *rule) {
+  board->rule = *rule;
+  _select_kernel(board);
+  for (size_t k = 0; k < (size_t)board->height * board->width; k++)
+    if ((int)board->cells[k] >= rule->states)
+      board->cells[k] = DEAD;
+  board->dirty = 1;
+  return board;
 }
 
 /**
@@ -148,23 +945,31 @@ int B_is_alive(Cell c) { return (c == ALIVE); }
  * @param board The 2D array of cells
  */
 void B_print(Board *board) {
+  // One row is built at a time, a colour is only set where a run of cells
+  // of the same state starts
+  char *line = (char *)malloc((size_t)board->width * 7 + 8);
+  if (line == NULL) {
+    printf("B_print: Could not allocate the line\nExiting...\n");
+    exit(1);
+  }
   for (int i = 0; i < board->height; i++) {
+    char *end = line;
     for (int j = 0; j < board->width; j++) {
-      if (B_is_alive(board->cell[i][j]))
-        set_backgound_color(RED_BKG);
-      else
-        set_backgound_color(WHITE_BKG);
-
-      // Print cell and reset color
-      printf("  ");
-      reset_color();
+      if (j == 0 || board->cell[i][j] != board->cell[i][j - 1])
+        end += sprintf(end, "\x1b[%dm",
+                       B_is_alive(board->cell[i][j]) ? RED_BKG : WHITE_BKG);
+      *end++ = ' ';
+      *end++ = ' ';
     }
-    printf("\n");
+    end += sprintf(end, "\x1b[%dm\n", RESET_COLOR);
+    fwrite(line, 1, (size_t)(end - line), stdout);
   }
+  free(line);
 }
 
 /**
- * Frees the memory allocated by the given board.
+ * Frees the memory allocated by the given board, or gives it back to its
+ * arena if it was taken from one.
  * @param board Pointer to struct board
  */
 void B_destroy(Board *board) {
@@ -172,36 +977,82 @@ void B_destroy(Board *board) {
     printf("B_destroy: Passed value is NULL\nExiting...\n");
     exit(1);
   }
-  for (int i = 0; i < board->height; i++) {
-    free(board->cell[i]);
+  if (board->arena != NULL) {
+    AR_release(board->arena, board);
+    return;
   }
-  free(board->cell);
+  // The lower of the two generation pointers is the start of the block
+  free(board->cells < board->next ? board->cells : board->next);
+  free(board->cell < board->next_cell ? board->cell : board->next_cell);
+  free(board->changed);
   free(board);
 }
 
+/** Arguments of the generation of a board by bands of rows */
+typedef struct {
+  Board *board;            /**< Board being generated */
+  uint32_t threshold;      /**< Draws below it give alive cells */
+  unsigned long long seed; /**< Seed of the random numbers */
+} GenerateTask;
+
+/**
+ * Task of the thread pool generating one row band of the board
+ * @param arg Pointer to the GenerateTask
+ * @param band Index of the band generated by the calling thread
+ * @param bands Number of bands the board is split into
+ */
+static void _generate_band(void *arg, int band, int bands) {
+  GenerateTask *task = (GenerateTask *)arg;
+  Board *board = task->board;
+  int begin = (int)((long long)board->height * band / bands);
+  int end = (int)((long long)board->height * (band + 1) / bands);
+
+  for (int i = begin; i < end; i++) {
+    Cell *row = board->cell[i];
+    for (int j = 0; j < board->width; j += R_CELLS) {
+      uint64_t r = R_random(task->seed, R_counter(i, j));
+      for (int k = 0; k < R_CELLS && j + k < board->width; k++, r >>= 16)
+        row[j + k] = (r & 0xFFFF) < task->threshold ? ALIVE : DEAD;
+    }
+  }
+}
+
 /**
  * Generates random arrangement of dead and alive cells of given board.
  * @param board Pointer to struct board
  * @param p Probability of cell being alive. Range of p is [0; 100]. Otherwise
  * print error to console and terminate the execution.
+ * @param seed Seed of the random numbers, the same seed gives the same board
  * @return Pointer to struct board
  */
-Board *B_generate(Board *board, int p) {
+Board *B_generate(Board *board, int p, unsigned long long seed) {
+  return B_generate_parallel(board, p, seed, NULL);
+}
+
+/**
+ * Generates random arrangement of dead and alive cells of given board using
+ * every thread of the pool. Every cell is drawn from a counter-based random
+ * number of its own position, so the board only depends on the seed and not
+ * on the number of threads.
+ * @param board Pointer to struct board
+ * @param p Probability of cell being alive. Range of p is [0; 100]. Otherwise
+ * print error to console and terminate the execution.
+ * @param seed Seed of the random numbers, the same seed gives the same board
+ * @param pool Pointer to the thread pool, NULL to use the calling thread
+ * @return Pointer to struct board
+ */
+Board *B_generate_parallel(Board *board, int p, unsigned long long seed,
+                           ThreadPool *pool) {
   if (p < 0 || p > 100) {
     printf("Probability should be between 0 and 100");
     exit(1);
   }
-  srand((unsigned)time(NULL));
-  int d;
-  for (int i = 0; i < board->height; i++) {
-    for (int j = 0; j < board->width; j++) {
-      d = rand() % 100;
-      if (d < p)
-        B_set_alive(board, i, j);
-      else
-        B_set_dead(board, i, j);
-    }
-  }
+  GenerateTask task = {board, R_threshold(p), seed};
+  if (pool != NULL)
+    TP_run(pool, _generate_band, &task);
+  else
+    _generate_band(&task, 0, 1);
+  board->dirty = 1;
   return board;
 }
 
@@ -213,6 +1064,7 @@ Board *B_generate(Board *board, int p) {
  */
 void B_set_dead(Board *board, int row, int col) {
   board->cell[row][col] = DEAD;
+  board->dirty = 1;
 }
 
 /**
@@ -223,4 +1075,5 @@ void B_set_dead(Board *board, int row, int col) {
  */
 void B_set_alive(Board *board, int row, int col) {
   board->cell[row][col] = ALIVE;
+  board->dirty = 1;
 }
\ No newline at end of file
@@ -5,32 +5,93 @@
 #ifndef BOARD_H
 #define BOARD_H
 
-/** Cell can be represented either as DEAD or ALIVE */
-typedef enum { DEAD, ALIVE } Cell;
+#include <pool.h>
+#include <rule.h>
+#include <stats.h>
+
+/** Cell can be represented either as DEAD or ALIVE. Generations rules add
+ * the dying states DYING, DYING + 1, ... up to their number of states - 1:
+ * such cells are not alive and are dead again after the last one. */
+typedef enum { DEAD, ALIVE, DYING } Cell;
 
 /** The board can work either by rules of version CLIPPED (the board is not
  * invinite and the are defined borders) or of version CIRCULAR (the board is
- * infinite and the are no actual borders)  */
-typedef enum { CLIPPED, CIRCULAR } Version;
+ * infinite and the are no actual borders). With version UNBOUNDED the plane
+ * really is infinite: it lives in a SparseBoard and a Board only shows a
+ * window of it, stepping like CLIPPED on its own. */
+typedef enum { CLIPPED, CIRCULAR, UNBOUNDED } Version;
+
+/** Alignment in bytes of the contiguous cell buffers */
+#define B_ALIGNMENT (64)
+
+/** Number of columns whose sums are kept at once by the update kernel */
+#define B_CHUNK (4096)
+
+/** Side in cells of the square tiles used to skip unchanged areas */
+#define B_TILE (64)
+
+/** Cache size in bytes assumed for the temporal blocks when the system does
+ * not tell the one of its L2 cache */
+#define B_BLOCK_CACHE (256 * 1024)
+
+struct BoardArena;
 
-/** Board sturct containing height, width and the 2D array of cells*/
+/** Board sturct containing height, width and the 2D array of cells. Both
+ * generations live in one contiguous aligned block: the current one is
+ * reachable through cells/cell, the next one is written into the back buffer
+ * by B_step and the two are swapped afterwards. */
 typedef struct {
   int height;      /**< Represents height of the board */
   int width;       /**< Represents width of the board */
   Version version; /**< Represents the rules of the board according to the
                       version as either CLIPPED or CIRCULAR */
   Cell **cell;     /**< 2D array of cells that are layed on the board and
-                      represented either DEAD or ALIVE*/
+                      represented either DEAD or ALIVE (row pointers into
+                      cells) */
+  Cell *cells;     /**< Contiguous row-major buffer of the current
+                      generation */
+  Cell *next;      /**< Contiguous back buffer receiving the next
+                      generation */
+  Cell **next_cell; /**< Row pointers into the back buffer */
+  int tile_rows;   /**< Number of rows of tiles, 0 without activity tracking */
+  int tile_cols;   /**< Number of columns of tiles */
+  unsigned char *changed; /**< Per tile: changed during the last step */
+  unsigned char *active;  /**< Per tile: has to be computed in the next step */
+  int active_tiles; /**< Number of tiles computed during the last step */
+  int dirty;       /**< Set when cells were written outside of a step, so
+                      that every tile is computed again. Code writing cell
+                      directly has to set it. */
+  Rule rule;       /**< Rule applied by the steps, B3/S23 by default */
+  StatsCollector *stats; /**< Receives the statistics of the steps, NULL
+                            by default */
+  int kernel;      /**< Kernel of the steps, chosen from the version, the
+                      rule and the width, see B_kernel_name */
+  struct BoardArena *arena; /**< Arena the board goes back to on B_destroy,
+                               NULL when it was allocated on its own */
 } Board;
 
 Board *B_new(int height, int width, Version version);
 Board *B_update(Board *board);
+Board *B_step(Board *board);
+Board *B_step_parallel(Board *board, ThreadPool *pool);
+Board *B_step_n(Board *board, long long generations, ThreadPool *pool);
+Board *B_step_blocked(Board *board, long long generations, int tile,
+                      int depth, ThreadPool *pool);
+void B_block_shape(int *tile, int *depth);
+Board *B_next_rows(Board *board, int begin, int end);
+Board *B_swap(Board *board);
+void B_track_activity(Board *board, int enable);
+void B_collect_stats(Board *board, StatsCollector *stats);
+const char *B_kernel_name(Board *board);
+int B_active_tiles(Board *board);
 Board *B_reset(Board *board);
-Board *B_generate(Board *board, int p);
+Board *B_set_rule(Board *board, const Rule *rule);
+Board *B_generate(Board *board, int p, unsigned long long seed);
+Board *B_generate_parallel(Board *board, int p, unsigned long long seed,
+                           ThreadPool *pool);
 void B_destroy(Board *board);
 void B_print(Board *board);
 void B_set_dead(Board *board, int row, int col);
 void B_set_alive(Board *board, int row, int col);
 int B_is_alive(Cell c);
-static int _count_alive_neighbours(Board *board, int i, int j);
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+ * @file cycle.c
+ * @brief Contains the detection of still lifes and oscillators. After
+ * B_step the back buffer of the board holds the previous generation, so the
+ * cells that changed are the ones that differ between the two buffers.
+ */
+#include <cycle.h>
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Seed of the keys of the cells */
+#define CD_SEED (0x5A0B1A5Cu)
+
+/**
+ * Returns the key of a cell in a state, XORed into the hash while the cell is
+ * in that state. Dead cells have no key and the dying states of Generations
+ * rules have their own ones.
+ * @param row Row of the cell
+ * @param col Column of the cell
+ * @param state State of the cell
+ * @return Random 64-bit key, 0 for a dead cell
+ */
+static inline uint64_t _key(int row, int col, Cell state) {
+  if (state == DEAD)
+    return 0;
+  return R_random(CD_SEED + (state - ALIVE),
+                  ((uint64_t)(uint32_t)row << 32) | (uint32_t)col);
+}
+
+/**
+ * Returns the XOR of the keys of the cells of a region that changed during
+ * the last step
+ * @param board Pointer to the struct Board
+ * @param row First row of the region
+ * @param row_end Row after the last one of the region
+ * @param col First column of the region
+ * @param col_end Column after the last one of the region
+ * @return Change of the hash
+ */
+static uint64_t _changes(Board *board, int row, int row_end, int col,
+                         int col_end) {
+  uint64_t hash = 0;
+  for (int i = row; i < row_end; i++) {
+    const Cell *now = board->cell[i], *before = board->next_cell[i];
+    for (int j = col; j < col_end; j++)
+      if (now[j] != before[j])
+        hash ^= _key(i, j, now[j]) ^ _key(i, j, before[j]);
+  }
+  return hash;
+}
+
+/**
+ * Computes the hash of the current generation of the board from scratch
+ * @param board Pointer to the struct Board
+ * @return Hash of the generation, 0 for an empty board
+ */
+uint64_t CD_hash(Board *board) {
+  uint64_t hash = 0;
+  for (int i = 0; i < board->height; i++)
+    for (int j = 0; j < board->width; j++)
+      if (board->cell[i][j] != DEAD)
+        hash ^= _key(i, j, board->cell[i][j]);
+  return hash;
+}
+
+/**
+ * Creates a detector whose generation 0 is the current one of the board
+ * @param board Pointer to the struct Board
+ * @return Pointer to the detector
+ */
+CycleDetector *CD_new(Board *board) {
+  CycleDetector *detector = (CycleDetector *)malloc(sizeof(CycleDetector));
+  if (detector == NULL) {
+    printf("CD_new: Could not allocate the detector\nExiting...\n");
+    exit(1);
+  }
+  detector->generation = 0;
+  CD_reset(detector, board);
+  return detector;
+}
+
+/**
+ * Forgets the past generations and hashes the current one again. Has to be
+ * called after cells of the board were written outside of a step.
+ * @param detector Pointer to the detector
+ * @param board Pointer to the struct Board
+ */
+void CD_reset(CycleDetector *detector, Board *board) {
+  detector->hash = CD_hash(board);
+  detector->ring[0].hash = detector->hash;
+  detector->ring[0].generation = detector->generation;
+  detector->count = 1;
+  detector->head = 1;
+  detector->start = 0;
+  detector->period = 0;
+}
+
+/**
+ * Updates the hash after a step of the board with B_step or B_step_parallel
+ * and looks for it among the recent generations. With activity tracking only
+ * the tiles that changed are compared.
+ * @param detector Pointer to the detector
+ * @param board Pointer to the struct Board, stepped once since the last call
+ * @return Period of the cycle the board is in, 0 if none was found yet
+ */
+long long CD_observe(CycleDetector *detector, Board *board) {
+  if (board->tile_rows > 0) {
+    for (int t = 0; t < board->tile_rows * board->tile_cols; t++) {
+      if (!board->changed[t])
+        continue;
+      int row = t / board->tile_cols * B_TILE;
+      int col = t % board->tile_cols * B_TILE;
+      detector->hash ^= _changes(
+          board, row, row + B_TILE < board->height ? row + B_TILE : board->height,
+          col, col + B_TILE < board->width ? col + B_TILE : board->width);
+    }
+  } else {
+    detector->hash ^= _changes(board, 0, board->height, 0, board->width);
+  }
+  detector->generation++;
+
+  // The first match is the start of the cycle since every generation since
+  // then is still in the ring
+  for (int k = 1; k <= detector->count && detector->period == 0; k++) {
+    CD_Entry *entry =
+        &detector->ring[(detector->head - k + CD_HISTORY) % CD_HISTORY];
+    if (entry->hash == detector->hash) {
+      detector->start = entry->generation;
+      detector->period = detector->generation - entry->generation;
+    }
+  }
+
+  detector->ring[detector->head].hash = detector->hash;
+  detector->ring[detector->head].generation = detector->generation;
+  detector->head = (detector->head + 1) % CD_HISTORY;
+  if (detector->count < CD_HISTORY)
+    detector->count++;
+  return detector->period;
+}
+
+/**
+ * Returns the number of steps left to reach the cells of the target
+ * generation. Once a cycle was found the board only has to go around it
+ * once at most.
+ * @param detector Pointer to the detector
+ * @param target Number of the generation wanted
+ * @return Number of steps to take, 0 if the target is already reached
+ */
+long long CD_skip(CycleDetector *detector, long long target) {
+  long long left = target - detector->generation;
+  if (left <= 0)
+    return 0;
+  return detector->period > 0 ? left % detector->period : left;
+}
+
+/**
+ * Frees the memory allocated by the given detector.
+ * @param detector Pointer to the detector
+ */
+void CD_destroy(CycleDetector *detector) {
+  if (detector == NULL) {
+    printf("CD_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  free(detector);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file cycle.h
+ * @brief Header file for the detection of still lifes and oscillators by
+ * hashing every generation of a board
+ */
+#ifndef CYCLE_H
+#define CYCLE_H
+
+#include <board.h>
+#include <stdint.h>
+
+/** Number of recent generations remembered, the longest period detected */
+#define CD_HISTORY (64)
+
+/** Hash of a past generation */
+typedef struct {
+  uint64_t hash;       /**< Hash of the generation */
+  long long generation; /**< Number of the generation */
+} CD_Entry;
+
+/** Zobrist hash of the current generation of a board, the XOR of a random
+ * key per alive or dying cell, with a ring of the hashes of the recent
+ * generations. Since a step only flips the cells that changed, the hash is
+ * updated from them alone. */
+typedef struct {
+  uint64_t hash;                /**< Hash of the current generation */
+  long long generation;         /**< Number of the current generation */
+  CD_Entry ring[CD_HISTORY];    /**< Hashes of the recent generations */
+  int count;                    /**< Number of entries in the ring */
+  int head;                     /**< Index of the next entry to replace */
+  long long start;              /**< First generation of the cycle */
+  long long period;             /**< Period of the cycle, 0 until found */
+} CycleDetector;
+
+uint64_t CD_hash(Board *board);
+CycleDetector *CD_new(Board *board);
+void CD_reset(CycleDetector *detector, Board *board);
+long long CD_observe(CycleDetector *detector, Board *board);
+long long CD_skip(CycleDetector *detector, long long target);
+void CD_destroy(CycleDetector *detector);
+#endif
@@ -0,0 +1,603 @@
+/**
+ * @file distributed.c
+ * @brief Contains the board stepped by worker processes. Every worker owns a
+ * strip of full rows, so only rows have to be exchanged: each generation a
+ * worker sends its first and last rows to the workers above and below it,
+ * computes the rows that do not need theirs while the sockets carry them,
+ * and only then waits for the two halo rows to compute its edge rows. The
+ * workers only synchronize through their neighbours, the coordinator talks
+ * to them between runs of generations.
+ */
+#include <distributed.h>
+#include <errno.h>
+#include <poll.h>
+#include <packed.h>
+#include <random.h>
+#include <snapshot.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/** Requests of the coordinator to a worker */
+typedef enum {
+  DS_GENERATE, /**< Draw the cells, arg is the density and value the seed */
+  DS_SCATTER,  /**< Read the packed rows of the strip */
+  DS_STEP,     /**< Step value generations and reply the population */
+  DS_COUNT,    /**< Reply the population */
+  DS_GATHER,   /**< Write the packed rows of the strip */
+  DS_QUIT      /**< Exit */
+} DS_Request;
+
+/** Message of the coordinator to a worker */
+typedef struct {
+  int32_t type;   /**< A DS_Request */
+  int32_t arg;    /**< Small argument */
+  uint64_t value; /**< Large argument */
+} DS_Message;
+
+/** One direction of the halo exchange of a worker */
+typedef struct {
+  int fd;         /**< Socket to the neighbour, -1 at the edge of a CLIPPED
+                     board */
+  uint64_t *out;  /**< Packed edge row sent to the neighbour */
+  uint64_t *in;   /**< Packed halo row received from the neighbour */
+  size_t sent;    /**< Number of bytes of out sent so far */
+  size_t got;     /**< Number of bytes of in received so far */
+} DS_Link;
+
+/** State of a worker process */
+typedef struct {
+  Board *board;   /**< The strip, rows 0 and rows + 1 being the halos */
+  int rows;       /**< Number of rows owned */
+  int first;      /**< Row of the board of the first row owned */
+  size_t bytes;   /**< Number of bytes of a packed row */
+  DS_Link up;     /**< Exchange with the worker above */
+  DS_Link down;   /**< Exchange with the worker below */
+} DS_Worker;
+
+/**
+ * Writes a whole buffer to a socket
+ * @param fd The socket
+ * @param data The buffer
+ * @param size Number of bytes
+ * @return 0 on success, -1 otherwise
+ */
+static int _write_all(int fd, const void *data, size_t size) {
+  const char *at = (const char *)data;
+  while (size > 0) {
+    ssize_t n = write(fd, at, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    at += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
+
+/**
+ * Reads a whole buffer from a socket
+ * @param fd The socket
+ * @param data Receives the bytes
+ * @param size Number of bytes
+ * @return 0 on success, -1 if the socket was closed or failed
+ */
+static int _read_all(int fd, void *data, size_t size) {
+  char *at = (char *)data;
+  while (size > 0) {
+    ssize_t n = read(fd, at, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return -1;
+    at += n;
+    size -= (size_t)n;
+  }
+  return 0;
+}
+
+/**
+ * Packs the alive cells of a row into words laid out like the rows of a
+ * PackedBoard
+ * @param row The cells
+ * @param width Number of cells
+ * @param words Receives the packed row
+ */
+static void _pack(const Cell *row, int width, uint64_t *words) {
+  memset(words, 0, (size_t)(width + PB_WORD_BITS - 1) / PB_WORD_BITS * 8);
+  for (int j = 0; j < width; j++)
+    if (row[j] == ALIVE)
+      words[j / PB_WORD_BITS] |= (uint64_t)1 << (j % PB_WORD_BITS);
+}
+
+/**
+ * Unpacks a packed row into alive and dead cells
+ * @param words The packed row
+ * @param width Number of cells
+ * @param row Receives the cells
+ */
+static void _unpack(const uint64_t *words, int width, Cell *row) {
+  for (int j = 0; j < width; j++)
+    row[j] =
+        (words[j / PB_WORD_BITS] >> (j % PB_WORD_BITS)) & 1 ? ALIVE : DEAD;
+}
+
+/**
+ * Moves the halo rows as far as the sockets allow
+ * @param worker Pointer to the worker
+ * @param wait 1 to wait until both rows are sent and received, 0 to return
+ * as soon as the sockets would block
+ * @return 0 on success, -1 if a neighbour is gone
+ */
+static int _pump(DS_Worker *worker, int wait) {
+  DS_Link *links[2] = {&worker->up, &worker->down};
+  size_t bytes = worker->bytes;
+
+  for (;;) {
+    struct pollfd fds[4];
+    int count = 0, pending = 0;
+    for (int k = 0; k < 2; k++) {
+      DS_Link *link = links[k];
+      if (link->fd < 0)
+        continue;
+      while (link->sent < bytes) {
+        ssize_t n = send(link->fd, (char *)link->out + link->sent,
+                         bytes - link->sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+          return -1;
+        if (n <= 0)
+          break;
+        link->sent += (size_t)n;
+      }
+      while (link->got < bytes) {
+        ssize_t n = recv(link->fd, (char *)link->in + link->got,
+                         bytes - link->got, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+          return -1;
+        if (n < 0)
+          break;
+        link->got += (size_t)n;
+      }
+      short events = (short)((link->sent < bytes ? POLLOUT : 0) |
+                             (link->got < bytes ? POLLIN : 0));
+      if (events != 0) {
+        fds[count].fd = link->fd;
+        fds[count].events = events;
+        count++;
+        pending = 1;
+      }
+    }
+    if (!pending || !wait)
+      return 0;
+    if (poll(fds, count, -1) < 0 && errno != EINTR)
+      return -1;
+  }
+}
+
+/**
+ * Steps the strip of a worker by one generation
+ * @param worker Pointer to the worker
+ * @return 0 on success, -1 if a neighbour is gone
+ */
+static int _step(DS_Worker *worker) {
+  Board *board = worker->board;
+  int rows = worker->rows, width = board->width;
+
+  _pack(board->cell[1], width, worker->up.out);
+  _pack(board->cell[rows], width, worker->down.out);
+  worker->up.sent = worker->up.got = 0;
+  worker->down.sent = worker->down.got = 0;
+
+  // The rows inside the strip are computed while the halos travel
+  if (_pump(worker, 0) != 0)
+    return -1;
+  B_next_rows(board, 2, rows);
+  if (_pump(worker, 1) != 0)
+    return -1;
+
+  _unpack(worker->up.in, width, board->cell[0]);
+  _unpack(worker->down.in, width, board->cell[rows + 1]);
+  B_next_rows(board, 1, 2);
+  if (rows > 1)
+    B_next_rows(board, rows, rows + 1);
+  B_swap(board);
+  return 0;
+}
+
+/**
+ * Counts the alive cells owned by a worker
+ * @param worker Pointer to the worker
+ * @return Population of the strip
+ */
+static uint64_t _population(DS_Worker *worker) {
+  uint64_t count = 0;
+  for (int i = 1; i <= worker->rows; i++)
+    for (int j = 0; j < worker->board->width; j++)
+      count += B_is_alive(worker->board->cell[i][j]);
+  return count;
+}
+
+/**
+ * Draws the cells of the strip exactly like B_generate draws the same rows
+ * of the whole board
+ * @param worker Pointer to the worker
+ * @param p Probability in percent of a cell being alive
+ * @param seed Seed of the random numbers
+ */
+static void _generate(DS_Worker *worker, int p, unsigned long long seed) {
+  uint32_t threshold = R_threshold(p);
+  for (int i = 0; i < worker->rows; i++) {
+    Cell *row = worker->board->cell[i + 1];
+    for (int j = 0; j < worker->board->width; j += R_CELLS) {
+      uint64_t r = R_random(seed, R_counter(worker->first + i, j));
+      for (int k = 0; k < R_CELLS && j + k < worker->board->width;
+           k++, r >>= 16)
+        row[j + k] = (r & 0xFFFF) < threshold ? ALIVE : DEAD;
+    }
+  }
+}
+
+/**
+ * Serves the requests of the coordinator until it quits or goes away
+ * @param worker Pointer to the worker
+ * @param control Socket to the coordinator
+ * @return Exit status of the worker process
+ */
+static int _serve(DS_Worker *worker, int control) {
+  size_t words = worker->bytes / sizeof(uint64_t);
+  uint64_t *row = (uint64_t *)malloc(worker->bytes);
+  DS_Message message;
+  if (row == NULL)
+    return 1;
+
+  while (_read_all(control, &message, sizeof(message)) == 0) {
+    uint64_t population;
+    switch (message.type) {
+    case DS_GENERATE:
+      _generate(worker, message.arg, message.value);
+      break;
+    case DS_SCATTER:
+      for (int i = 1; i <= worker->rows; i++) {
+        if (_read_all(control, row, words * sizeof(uint64_t)) != 0)
+          return 1;
+        _unpack(row, worker->board->width, worker->board->cell[i]);
+      }
+      break;
+    case DS_STEP:
+      for (uint64_t t = 0; t < message.value; t++)
+        if (_step(worker) != 0)
+          return 1;
+      /* fall through */
+    case DS_COUNT:
+      population = _population(worker);
+      if (_write_all(control, &population, sizeof(population)) != 0)
+        return 1;
+      break;
+    case DS_GATHER:
+      for (int i = 1; i <= worker->rows; i++) {
+        _pack(worker->board->cell[i], worker->board->width, row);
+        if (_write_all(control, row, worker->bytes) != 0)
+          return 1;
+      }
+      break;
+    default:
+      free(row);
+      return 0;
+    }
+  }
+  free(row);
+  return 0;
+}
+
+/**
+ * Sets up and runs a worker process
+ * @param ds Pointer to the distributed board, as it was when forking
+ * @param rule Rule of the board
+ * @param index Number of the worker
+ * @param up Socket to the worker above, -1 if none
+ * @param down Socket to the worker below, -1 if none
+ * @param control Socket to the coordinator
+ * @return Exit status of the worker process
+ */
+static int _work(Distributed *ds, const Rule *rule, int index, int up,
+                 int down, int control) {
+  DS_Worker worker;
+  worker.rows = ds->first[index + 1] - ds->first[index];
+  worker.first = ds->first[index];
+  worker.bytes = (size_t)ds->words * sizeof(uint64_t);
+  worker.board = B_set_rule(B_new(worker.rows + 2, ds->width, ds->version),
+                            rule);
+  worker.up.fd = up;
+  worker.down.fd = down;
+  uint64_t *rows = (uint64_t *)calloc(4 * (size_t)ds->words, sizeof(uint64_t));
+  if (rows == NULL)
+    return 1;
+  // Missing neighbours leave their halo dead and count as received
+  worker.up.out = rows;
+  worker.up.in = rows + ds->words;
+  worker.down.out = rows + 2 * (size_t)ds->words;
+  worker.down.in = rows + 3 * (size_t)ds->words;
+
+  int status = _serve(&worker, control);
+  free(rows);
+  B_destroy(worker.board);
+  return status;
+}
+
+/**
+ * Reads the reply of a worker, terminating the execution if it is gone
+ * @param ds Pointer to the distributed board
+ * @param k Number of the worker
+ * @param data Receives the reply
+ * @param size Number of bytes of the reply
+ */
+static void _reply(Distributed *ds, int k, void *data, size_t size) {
+  if (_read_all(ds->control[k], data, size) != 0) {
+    printf("DS: Lost worker %d\nExiting...\n", k);
+    exit(1);
+  }
+}
+
+/**
+ * Sends a request to a worker, terminating the execution if it is gone
+ * @param ds Pointer to the distributed board
+ * @param k Number of the worker
+ * @param type The DS_Request
+ * @param arg Small argument
+ * @param value Large argument
+ */
+static void _request(Distributed *ds, int k, DS_Request type, int arg,
+                     uint64_t value) {
+  DS_Message message = {(int32_t)type, arg, value};
+  if (_write_all(ds->control[k], &message, sizeof(message)) != 0) {
+    printf("DS: Lost worker %d\nExiting...\n", k);
+    exit(1);
+  }
+}
+
+/**
+ * Creates a dead board split into strips of rows, each one stepped by its
+ * own worker process. Neighbouring workers are linked by socket pairs, the
+ * last and the first too on a CIRCULAR board.
+ * @param height Height of the board
+ * @param width Width of the board
+ * @param version CLIPPED or CIRCULAR
+ * @param rule Pointer to the rule, NULL for B3/S23
+ * @param workers Number of worker processes, at most one per row
+ * @return Pointer to the distributed board
+ */
+Distributed *DS_new(int height, int width, Version version, const Rule *rule,
+                    int workers) {
+  Distributed *ds = (Distributed *)malloc(sizeof(Distributed));
+  Rule life;
+  if (workers > height)
+    workers = height;
+  if (workers > DS_WORKERS)
+    workers = DS_WORKERS;
+  if (workers < 1)
+    workers = 1;
+  int links = version == CIRCULAR ? workers : workers - 1;
+  int (*pairs)[2] = (int(*)[2])malloc((size_t)(links + 1) * sizeof(int[2]));
+  int (*controls)[2] = (int(*)[2])malloc((size_t)workers * sizeof(int[2]));
+  if (ds == NULL || pairs == NULL || controls == NULL) {
+    printf("DS_new: Could not allocate the board\nExiting...\n");
+    exit(1);
+  }
+  ds->height = height;
+  ds->width = width;
+  ds->version = version;
+  ds->words = (width + PB_WORD_BITS - 1) / PB_WORD_BITS;
+  ds->workers = workers;
+  ds->generation = 0;
+  ds->first = (int *)malloc((size_t)(workers + 1) * sizeof(int));
+  ds->pids = (pid_t *)malloc((size_t)workers * sizeof(pid_t));
+  ds->control = (int *)malloc((size_t)workers * sizeof(int));
+  if (ds->first == NULL || ds->pids == NULL || ds->control == NULL) {
+    printf("DS_new: Could not allocate the board\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k <= workers; k++)
+    ds->first[k] = (int)((long long)height * k / workers);
+  if (rule == NULL)
+    rule = RU_make(&life, 1 << 3, (1 << 2) | (1 << 3), 2);
+
+  // Link k joins the bottom of worker k to the top of worker k + 1
+  for (int k = 0; k < links; k++)
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[k]) != 0) {
+      printf("DS_new: Could not create the sockets\nExiting...\n");
+      exit(1);
+    }
+  for (int k = 0; k < workers; k++)
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, controls[k]) != 0) {
+      printf("DS_new: Could not create the sockets\nExiting...\n");
+      exit(1);
+    }
+
+  fflush(stdout);
+  for (int k = 0; k < workers; k++) {
+    ds->pids[k] = fork();
+    if (ds->pids[k] < 0) {
+      printf("DS_new: Could not start worker %d\nExiting...\n", k);
+      exit(1);
+    }
+    if (ds->pids[k] == 0) {
+      int up = k > 0 || links == workers ? pairs[(k + workers - 1) % workers][1]
+                                         : -1;
+      int down = k < links ? pairs[k][0] : -1;
+      // Only the sockets of this worker stay open
+      for (int l = 0; l < links; l++) {
+        if (pairs[l][1] != up)
+          close(pairs[l][1]);
+        if (pairs[l][0] != down)
+          close(pairs[l][0]);
+      }
+      for (int l = 0; l < workers; l++) {
+        close(controls[l][0]);
+        if (l != k)
+          close(controls[l][1]);
+      }
+      for (int l = 0; l < k; l++)
+        close(ds->control[l]);
+      _exit(_work(ds, rule, k, up, down, controls[k][1]));
+    }
+    ds->control[k] = controls[k][0];
+    close(controls[k][1]);
+  }
+  for (int k = 0; k < links; k++) {
+    close(pairs[k][0]);
+    close(pairs[k][1]);
+  }
+  free(pairs);
+  free(controls);
+  return ds;
+}
+
+/**
+ * Draws the cells of every strip, giving the same board as B_generate
+ * @param ds Pointer to the distributed board
+ * @param p Probability of cell being alive. Range of p is [0; 100]. Otherwise
+ * print error to console and terminate the execution.
+ * @param seed Seed of the random numbers
+ */
+void DS_generate(Distributed *ds, int p, unsigned long long seed) {
+  if (p < 0 || p > 100) {
+    printf("Probability should be between 0 and 100");
+    exit(1);
+  }
+  for (int k = 0; k < ds->workers; k++)
+    _request(ds, k, DS_GENERATE, p, seed);
+}
+
+/**
+ * Hands the cells of a board to the workers
+ * @param ds Pointer to the distributed board
+ * @param board Pointer to a struct Board of the same dimensions
+ */
+void DS_scatter(Distributed *ds, Board *board) {
+  uint64_t *row = (uint64_t *)malloc((size_t)ds->words * sizeof(uint64_t));
+  if (row == NULL) {
+    printf("DS_scatter: Could not allocate a row\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < ds->workers; k++) {
+    _request(ds, k, DS_SCATTER, 0, 0);
+    for (int i = ds->first[k]; i < ds->first[k + 1]; i++) {
+      _pack(board->cell[i], ds->width, row);
+      if (_write_all(ds->control[k], row, (size_t)ds->words * 8) != 0) {
+        printf("DS: Lost worker %d\nExiting...\n", k);
+        exit(1);
+      }
+    }
+  }
+  free(row);
+}
+
+/**
+ * Steps the board by the given number of generations. The workers go
+ * through them without the coordinator, which only waits for their
+ * populations at the end.
+ * @param ds Pointer to the distributed board
+ * @param generations Number of generations
+ * @return Population of the last generation
+ */
+uint64_t DS_step(Distributed *ds, long long generations) {
+  uint64_t population = 0, count;
+  for (int k = 0; k < ds->workers; k++)
+    _request(ds, k, DS_STEP, 0, (uint64_t)generations);
+  for (int k = 0; k < ds->workers; k++) {
+    _reply(ds, k, &count, sizeof(count));
+    population += count;
+  }
+  ds->generation += (uint64_t)generations;
+  return population;
+}
+
+/**
+ * Counts the alive cells of the board
+ * @param ds Pointer to the distributed board
+ * @return Population
+ */
+uint64_t DS_population(Distributed *ds) { return DS_step(ds, 0); }
+
+/**
+ * Copies the current generation of every strip into a board
+ * @param ds Pointer to the distributed board
+ * @param board Pointer to a struct Board of the same dimensions
+ * @return Pointer to the struct Board
+ */
+Board *DS_gather(Distributed *ds, Board *board) {
+  uint64_t *row = (uint64_t *)malloc((size_t)ds->words * sizeof(uint64_t));
+  if (row == NULL) {
+    printf("DS_gather: Could not allocate a row\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < ds->workers; k++) {
+    _request(ds, k, DS_GATHER, 0, 0);
+    for (int i = ds->first[k]; i < ds->first[k + 1]; i++) {
+      _reply(ds, k, row, (size_t)ds->words * sizeof(uint64_t));
+      _unpack(row, ds->width, board->cell[i]);
+    }
+  }
+  free(row);
+  board->dirty = 1;
+  return board;
+}
+
+/**
+ * Saves the current generation into a snapshot, streaming the rows from the
+ * workers so the whole board is never held by the coordinator
+ * @param ds Pointer to the distributed board
+ * @param path Path of the snapshot, replaced if it exists
+ * @param checksum 1 to store a checksum of the cells
+ * @return 0 on success, -1 otherwise
+ */
+int DS_save(Distributed *ds, const char *path, int checksum) {
+  SN_Writer *writer =
+      SN_begin(path, ds->height, ds->width, ds->version, ds->generation);
+  uint64_t *row = (uint64_t *)malloc((size_t)ds->words * sizeof(uint64_t));
+  if (row == NULL) {
+    printf("DS_save: Could not allocate a row\nExiting...\n");
+    exit(1);
+  }
+  // Every row is read, even after a failed write, to keep the sockets in step
+  for (int k = 0; k < ds->workers; k++) {
+    _request(ds, k, DS_GATHER, 0, 0);
+    for (int i = ds->first[k]; i < ds->first[k + 1]; i++) {
+      _reply(ds, k, row, (size_t)ds->words * sizeof(uint64_t));
+      if (writer != NULL)
+        SN_write_rows(writer, row, 1);
+    }
+  }
+  free(row);
+  return writer != NULL ? SN_end(writer, checksum) : -1;
+}
+
+/**
+ * Stops the workers and frees the memory of the distributed board
+ * @param ds Pointer to the distributed board
+ */
+void DS_destroy(Distributed *ds) {
+  if (ds == NULL) {
+    printf("DS_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < ds->workers; k++) {
+    DS_Message message = {DS_QUIT, 0, 0};
+    _write_all(ds->control[k], &message, sizeof(message));
+    close(ds->control[k]);
+  }
+  for (int k = 0; k < ds->workers; k++)
+    waitpid(ds->pids[k], NULL, 0);
+  free(ds->first);
+  free(ds->pids);
+  free(ds->control);
+  free(ds);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file distributed.h
+ * @brief Header file for the board split into strips of rows stepped by
+ * worker processes, which exchange their edge rows over Unix domain sockets
+ */
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <board.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Largest number of worker processes */
+#define DS_WORKERS (256)
+
+/** Board whose rows are owned by worker processes. The coordinator only
+ * keeps the sockets to the workers: each worker holds its strip of full rows
+ * with one halo row above and below it, received from its neighbours every
+ * generation. */
+typedef struct {
+  int height;          /**< Height of the board */
+  int width;           /**< Width of the board */
+  Version version;     /**< CLIPPED or CIRCULAR */
+  int words;           /**< Number of 64-bit words of a packed row */
+  int workers;         /**< Number of worker processes */
+  int *first;          /**< First row of every worker, then height */
+  pid_t *pids;         /**< Process of every worker */
+  int *control;        /**< Socket to every worker */
+  uint64_t generation; /**< Number of generations stepped */
+} Distributed;
+
+Distributed *DS_new(int height, int width, Version version, const Rule *rule,
+                    int workers);
+void DS_generate(Distributed *ds, int p, unsigned long long seed);
+void DS_scatter(Distributed *ds, Board *board);
+uint64_t DS_step(Distributed *ds, long long generations);
+uint64_t DS_population(Distributed *ds);
+Board *DS_gather(Distributed *ds, Board *board);
+int DS_save(Distributed *ds, const char *path, int checksum);
+void DS_destroy(Distributed *ds);
+#endif
@@ -0,0 +1,492 @@
+/**
+ * @file hashlife.c
+ * @brief Contains the HashLife engine. Every square of the plane is a node of
+ * a quadtree; equal squares share one node through a hash table, and each node
+ * remembers the centre of its square some generations later, so repeated
+ * structure in space and time is only ever computed once.
+ */
+#include <hashlife.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Smallest level of the root, 8 by 8 cells */
+#define HL_MIN_LEVEL (3)
+
+/** Largest level of the root so that its coordinates fit in 64 bits */
+#define HL_MAX_LEVEL (62)
+
+/**
+ * Hands out a fresh node from the current block, allocating a new block when
+ * it is full
+ * @param life Pointer to the universe
+ * @return Pointer to an uninitialized node
+ */
+static HL_Node *_alloc_node(HashLife *life) {
+  HL_Block *block = life->blocks;
+  int capacity = (int)(sizeof(block->nodes) / sizeof(block->nodes[0]));
+
+  if (block == NULL || block->used == capacity) {
+    block = (HL_Block *)malloc(sizeof(HL_Block));
+    if (block == NULL) {
+      printf("HashLife: Could not allocate nodes\nExiting...\n");
+      exit(1);
+    }
+    block->next = life->blocks;
+    block->used = 0;
+    life->blocks = block;
+  }
+  return &block->nodes[block->used++];
+}
+
+/**
+ * Hash of the four quadrants of a node
+ * @param nw North west quadrant
+ * @param ne North east quadrant
+ * @param sw South west quadrant
+ * @param se South east quadrant
+ * @return Hash value
+ */
+static size_t _hash(HL_Node *nw, HL_Node *ne, HL_Node *sw, HL_Node *se) {
+  uint64_t h = (uint64_t)(uintptr_t)nw * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)(uintptr_t)ne * 0xC2B2AE3D27D4EB4FULL;
+  h ^= (uint64_t)(uintptr_t)sw * 0x165667B19E3779F9ULL;
+  h ^= (uint64_t)(uintptr_t)se * 0x27D4EB2F165667C5ULL;
+  return (size_t)(h ^ (h >> 29));
+}
+
+/**
+ * Doubles the number of buckets of the hash table
+ * @param life Pointer to the universe
+ */
+static void _grow_table(HashLife *life) {
+  size_t count = life->bucket_count * 2;
+  HL_Node **buckets = (HL_Node **)calloc(count, sizeof(HL_Node *));
+  if (buckets == NULL) {
+    printf("HashLife: Could not grow the hash table\nExiting...\n");
+    exit(1);
+  }
+  for (size_t b = 0; b < life->bucket_count; b++) {
+    HL_Node *node = life->buckets[b];
+    while (node != NULL) {
+      HL_Node *next = node->hash_next;
+      size_t h = _hash(node->nw, node->ne, node->sw, node->se) & (count - 1);
+      node->hash_next = buckets[h];
+      buckets[h] = node;
+      node = next;
+    }
+  }
+  free(life->buckets);
+  life->buckets = buckets;
+  life->bucket_count = count;
+}
+
+/**
+ * Returns the unique node made of the four given quadrants
+ * @param life Pointer to the universe
+ * @param nw North west quadrant
+ * @param ne North east quadrant
+ * @param sw South west quadrant
+ * @param se South east quadrant
+ * @return Pointer to the node one level above the quadrants
+ */
+static HL_Node *_join(HashLife *life, HL_Node *nw, HL_Node *ne, HL_Node *sw,
+                      HL_Node *se) {
+  size_t h = _hash(nw, ne, sw, se) & (life->bucket_count - 1);
+  for (HL_Node *node = life->buckets[h]; node != NULL; node = node->hash_next)
+    if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se)
+      return node;
+
+  HL_Node *node = _alloc_node(life);
+  node->level = nw->level + 1;
+  node->nw = nw;
+  node->ne = ne;
+  node->sw = sw;
+  node->se = se;
+  node->result = NULL;
+  node->population =
+      nw->population + ne->population + sw->population + se->population;
+  node->hash_next = life->buckets[h];
+  life->buckets[h] = node;
+  if (++life->node_count > life->bucket_count)
+    _grow_table(life);
+  return node;
+}
+
+/**
+ * Returns the empty square of the given level
+ * @param life Pointer to the universe
+ * @param level Level of the square
+ * @return Pointer to the node
+ */
+static HL_Node *_empty(HashLife *life, int level) {
+  if (level == 0)
+    return life->dead;
+  if (life->empty[level] == NULL) {
+    HL_Node *quadrant = _empty(life, level - 1);
+    life->empty[level] = _join(life, quadrant, quadrant, quadrant, quadrant);
+  }
+  return life->empty[level];
+}
+
+/**
+ * Creates new empty universe
+ * @return Pointer to the universe
+ */
+HashLife *HL_new(void) {
+  HashLife *life = (HashLife *)calloc(1, sizeof(HashLife));
+  if (life == NULL) {
+    printf("HL_new: Could not allocate the universe\nExiting...\n");
+    exit(1);
+  }
+  life->bucket_count = 1 << 12;
+  life->buckets = (HL_Node **)calloc(life->bucket_count, sizeof(HL_Node *));
+  life->dead = _alloc_node(life);
+  life->alive = _alloc_node(life);
+  *life->dead = (HL_Node){0, NULL, NULL, NULL, NULL, NULL, NULL, 0};
+  *life->alive = (HL_Node){0, NULL, NULL, NULL, NULL, NULL, NULL, 1};
+  life->root = _empty(life, HL_MIN_LEVEL);
+  return life;
+}
+
+/**
+ * Builds the node of the square of the board at the given position, cells
+ * outside of the board being dead
+ * @param life Pointer to the universe
+ * @param board Pointer to struct board
+ * @param level Level of the square
+ * @param row Row of the north west corner of the square
+ * @param col Column of the north west corner of the square
+ * @return Pointer to the node
+ */
+static HL_Node *_build(HashLife *life, Board *board, int level, int64_t row,
+                       int64_t col) {
+  if (row >= board->height || col >= board->width)
+    return _empty(life, level);
+  if (level == 0)
+    return B_is_alive(board->cell[row][col]) ? life->alive : life->dead;
+  int64_t half = (int64_t)1 << (level - 1);
+  return _join(life, _build(life, board, level - 1, row, col),
+               _build(life, board, level - 1, row, col + half),
+               _build(life, board, level - 1, row + half, col),
+               _build(life, board, level - 1, row + half, col + half));
+}
+
+/**
+ * Creates a universe holding the current generation of the board, its north
+ * west corner at row 0 and column 0 of the plane. The board is placed on the
+ * infinite plane: neither the CIRCULAR wrapping nor the CLIPPED borders are
+ * kept.
+ * @param board Pointer to struct board
+ * @return Pointer to the universe
+ */
+HashLife *HL_from_board(Board *board) {
+  HashLife *life = HL_new();
+  int level = HL_MIN_LEVEL;
+  while (((int64_t)1 << level) < board->height ||
+         ((int64_t)1 << level) < board->width)
+    level++;
+  life->root = _build(life, board, level, 0, 0);
+  return life;
+}
+
+/**
+ * Writes the alive cells of a node that fall inside the board window
+ * @param node Pointer to the node
+ * @param board Pointer to struct board
+ * @param row Row of the north west corner of the node relative to the board
+ * @param col Column of the north west corner of the node relative to the board
+ */
+static void _emit(HL_Node *node, Board *board, int64_t row, int64_t col) {
+  int64_t size = (int64_t)1 << node->level;
+  if (node->population == 0 || row >= board->height || col >= board->width ||
+      row + size <= 0 || col + size <= 0)
+    return;
+  if (node->level == 0) {
+    B_set_alive(board, (int)row, (int)col);
+    return;
+  }
+  int64_t half = size / 2;
+  _emit(node->nw, board, row, col);
+  _emit(node->ne, board, row, col + half);
+  _emit(node->sw, board, row + half, col);
+  _emit(node->se, board, row + half, col + half);
+}
+
+/**
+ * Writes the window of the plane starting at the given coordinates into the
+ * board
+ * @param life Pointer to the universe
+ * @param board Pointer to struct board receiving the window
+ * @param row Row of the plane shown on the first row of the board
+ * @param col Column of the plane shown on the first column of the board
+ * @return Pointer to struct board
+ */
+Board *HL_to_board(HashLife *life, Board *board, int64_t row, int64_t col) {
+  B_reset(board);
+  _emit(life->root, board, life->row - row, life->col - col);
+  return board;
+}
+
+/**
+ * Doubles the size of the root, keeping its content in the centre
+ * @param life Pointer to the universe
+ */
+static void _expand(HashLife *life) {
+  HL_Node *root = life->root;
+  HL_Node *e = _empty(life, root->level - 1);
+  int64_t half = (int64_t)1 << (root->level - 1);
+
+  if (root->level >= HL_MAX_LEVEL) {
+    printf("HashLife: The pattern is too large\nExiting...\n");
+    exit(1);
+  }
+  life->root = _join(life, _join(life, e, e, e, root->nw),
+                     _join(life, e, e, root->ne, e),
+                     _join(life, e, root->sw, e, e),
+                     _join(life, root->se, e, e, e));
+  life->row -= half;
+  life->col -= half;
+}
+
+/**
+ * Returns the replacement of a node with one cell changed
+ * @param life Pointer to the universe
+ * @param node Pointer to the node
+ * @param row Row of the cell relative to the node
+ * @param col Column of the cell relative to the node
+ * @param cell The new cell, life->alive or life->dead
+ * @return Pointer to the new node
+ */
+static HL_Node *_set(HashLife *life, HL_Node *node, int64_t row, int64_t col,
+                     HL_Node *cell) {
+  if (node->level == 0)
+    return cell;
+  int64_t half = (int64_t)1 << (node->level - 1);
+  HL_Node *q[4] = {node->nw, node->ne, node->sw, node->se};
+  int k = (row >= half) * 2 + (col >= half);
+  q[k] = _set(life, q[k], row % half, col % half, cell);
+  return _join(life, q[0], q[1], q[2], q[3]);
+}
+
+/**
+ * Makes the cell at given coordinates of the plane alive
+ * @param life Pointer to the universe
+ * @param row Row of the cell
+ * @param col Column of the cell
+ */
+void HL_set_alive(HashLife *life, int64_t row, int64_t col) {
+  while (row < life->row || col < life->col ||
+         row - life->row >= ((int64_t)1 << life->root->level) ||
+         col - life->col >= ((int64_t)1 << life->root->level))
+    _expand(life);
+  life->root =
+      _set(life, life->root, row - life->row, col - life->col, life->alive);
+}
+
+/**
+ * Checks if the cell at given coordinates of the plane is alive
+ * @param life Pointer to the universe
+ * @param row Row of the cell
+ * @param col Column of the cell
+ * @return 1 If the cell is alive. Otherwise return 0.
+ */
+int HL_is_alive(HashLife *life, int64_t row, int64_t col) {
+  HL_Node *node = life->root;
+  row -= life->row;
+  col -= life->col;
+  if (row < 0 || col < 0 || row >= ((int64_t)1 << node->level) ||
+      col >= ((int64_t)1 << node->level))
+    return 0;
+  while (node->level > 0 && node->population > 0) {
+    int64_t half = (int64_t)1 << (node->level - 1);
+    if (row < half)
+      node = col < half ? node->nw : node->ne;
+    else
+      node = col < half ? node->sw : node->se;
+    row %= half;
+    col %= half;
+  }
+  return node == life->alive;
+}
+
+/**
+ * Returns the number of alive cells on the plane
+ * @param life Pointer to the universe
+ * @return Population
+ */
+uint64_t HL_population(HashLife *life) { return life->root->population; }
+
+/**
+ * Centre square of a node, one level below it
+ * @param life Pointer to the universe
+ * @param n Pointer to a node of level 2 or more
+ * @return Pointer to the centre node
+ */
+static HL_Node *_centre(HashLife *life, HL_Node *n) {
+  return _join(life, n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+/**
+ * Square straddling the border between two horizontally adjacent nodes
+ * @param life Pointer to the universe
+ * @param w Pointer to the west node
+ * @param e Pointer to the east node
+ * @return Pointer to the node of the same level
+ */
+static HL_Node *_centre_horizontal(HashLife *life, HL_Node *w, HL_Node *e) {
+  return _join(life, w->ne, e->nw, w->se, e->sw);
+}
+
+/**
+ * Square straddling the border between two vertically adjacent nodes
+ * @param life Pointer to the universe
+ * @param n Pointer to the north node
+ * @param s Pointer to the south node
+ * @return Pointer to the node of the same level
+ */
+static HL_Node *_centre_vertical(HashLife *life, HL_Node *n, HL_Node *s) {
+  return _join(life, n->sw, n->se, s->nw, s->ne);
+}
+
+/**
+ * Advances the centre 2x2 cells of a 4x4 square by one generation
+ * @param life Pointer to the universe
+ * @param node Pointer to a node of level 2
+ * @return Pointer to the node of level 1
+ */
+static HL_Node *_next_level2(HashLife *life, HL_Node *node) {
+  int cells[4][4];
+  HL_Node *q[4] = {node->nw, node->ne, node->sw, node->se};
+  for (int k = 0; k < 4; k++) {
+    int r = (k / 2) * 2, c = (k % 2) * 2;
+    cells[r][c] = (int)q[k]->nw->population;
+    cells[r][c + 1] = (int)q[k]->ne->population;
+    cells[r + 1][c] = (int)q[k]->sw->population;
+    cells[r + 1][c + 1] = (int)q[k]->se->population;
+  }
+
+  HL_Node *out[4];
+  for (int k = 0; k < 4; k++) {
+    int r = 1 + k / 2, c = 1 + k % 2, count = 0;
+    for (int dr = -1; dr <= 1; dr++)
+      for (int dc = -1; dc <= 1; dc++)
+        if (dr != 0 || dc != 0)
+          count += cells[r + dr][c + dc];
+    out[k] = (count == 3 || (count == 2 && cells[r][c])) ? life->alive
+                                                         : life->dead;
+  }
+  return _join(life, out[0], out[1], out[2], out[3]);
+}
+
+/**
+ * Returns the centre of a node advanced by 2^min(level - 2, step)
+ * generations, computing and memoizing it on the first call
+ * @param life Pointer to the universe
+ * @param node Pointer to a node of level 2 or more
+ * @return Pointer to the node one level below
+ */
+static HL_Node *_next(HashLife *life, HL_Node *node) {
+  if (node->result != NULL)
+    return node->result;
+  if (node->population == 0)
+    return node->result = _empty(life, node->level - 1);
+  if (node->level == 2)
+    return node->result = _next_level2(life, node);
+
+  // The nine overlapping squares of half the size covering the node
+  HL_Node *n[9] = {node->nw,
+                   _centre_horizontal(life, node->nw, node->ne),
+                   node->ne,
+                   _centre_vertical(life, node->nw, node->sw),
+                   _centre(life, node),
+                   _centre_vertical(life, node->ne, node->se),
+                   node->sw,
+                   _centre_horizontal(life, node->sw, node->se),
+                   node->se};
+
+  // A full step advances twice by 2^(level - 3); a shorter one only advances
+  // in the second half and merely takes the centres in the first
+  int full = node->level - 2 <= life->step;
+  for (int k = 0; k < 9; k++)
+    n[k] = full ? _next(life, n[k]) : _centre(life, n[k]);
+
+  return node->result = _join(
+             life, _next(life, _join(life, n[0], n[1], n[3], n[4])),
+             _next(life, _join(life, n[1], n[2], n[4], n[5])),
+             _next(life, _join(life, n[3], n[4], n[6], n[7])),
+             _next(life, _join(life, n[4], n[5], n[7], n[8])));
+}
+
+/**
+ * Forgets the memoized results, which are only valid for one step size
+ * @param life Pointer to the universe
+ */
+static void _clear_results(HashLife *life) {
+  for (HL_Block *block = life->blocks; block != NULL; block = block->next)
+    for (int k = 0; k < block->used; k++)
+      block->nodes[k].result = NULL;
+}
+
+/**
+ * Advances the universe by 2^k generations at once
+ * @param life Pointer to the universe
+ * @param k Power of two of the number of generations, from 0 to 60
+ * @return Pointer to the universe
+ */
+HashLife *HL_step(HashLife *life, int k) {
+  if (k < 0 || k > HL_MAX_LEVEL - 3) {
+    printf("HL_step: Step should be between 2^0 and 2^%d\nExiting...\n",
+           HL_MAX_LEVEL - 3);
+    exit(1);
+  }
+  if (k != life->step) {
+    _clear_results(life);
+    life->step = k;
+  }
+
+  // Light speed is one cell per generation: the pattern has to fit in the
+  // inner quarter of the root so that its centre can hold the result
+  while (life->root->level < k + 3 ||
+         _centre(life, _centre(life, life->root))->population !=
+             life->root->population)
+    _expand(life);
+
+  int64_t quarter = (int64_t)1 << (life->root->level - 2);
+  life->root = _next(life, life->root);
+  life->row += quarter;
+  life->col += quarter;
+  life->generation += (uint64_t)1 << k;
+  return life;
+}
+
+/**
+ * Advances the universe by any number of generations, as a sum of powers of
+ * two
+ * @param life Pointer to the universe
+ * @param generations Number of generations
+ * @return Pointer to the universe
+ */
+HashLife *HL_advance(HashLife *life, uint64_t generations) {
+  for (int k = 0; generations != 0; k++, generations >>= 1)
+    if (generations & 1)
+      HL_step(life, k);
+  return life;
+}
+
+/**
+ * Frees the memory allocated by the given universe.
+ * @param life Pointer to the universe
+ */
+void HL_destroy(HashLife *life) {
+  if (life == NULL) {
+    printf("HL_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  while (life->blocks != NULL) {
+    HL_Block *next = life->blocks->next;
+    free(life->blocks);
+    life->blocks = next;
+  }
+  free(life->buckets);
+  free(life);
+}
@@ -0,0 +1,58 @@
+/**
+ * @file hashlife.h
+ * @brief Header file for the HashLife engine: a hash-consed quadtree whose
+ * nodes memoize their future, used to jump far ahead on the infinite plane
+ */
+#ifndef HASHLIFE_H
+#define HASHLIFE_H
+
+#include <board.h>
+#include <stdint.h>
+
+/** Quadtree node covering a square of 2^level by 2^level cells. Nodes are
+ * unique: two equal squares are always the same node. */
+typedef struct HL_Node {
+  int level;                   /**< Size of the square as a power of two */
+  struct HL_Node *nw;          /**< North west quadrant, NULL for cells */
+  struct HL_Node *ne;          /**< North east quadrant */
+  struct HL_Node *sw;          /**< South west quadrant */
+  struct HL_Node *se;          /**< South east quadrant */
+  struct HL_Node *result;      /**< Memoized centre square advanced by
+                                  HL_step, NULL until computed */
+  struct HL_Node *hash_next;   /**< Next node in the same hash bucket */
+  uint64_t population;         /**< Number of alive cells */
+} HL_Node;
+
+/** Block of nodes allocated at once */
+typedef struct HL_Block {
+  struct HL_Block *next; /**< Previously allocated block */
+  int used;              /**< Number of nodes handed out from this block */
+  HL_Node nodes[4096];   /**< Storage of the nodes */
+} HL_Block;
+
+/** HashLife universe holding the whole infinite plane */
+typedef struct {
+  HL_Node **buckets;     /**< Hash table of all the nodes */
+  size_t bucket_count;   /**< Number of buckets, a power of two */
+  size_t node_count;     /**< Number of nodes in the table */
+  HL_Block *blocks;      /**< Node storage */
+  HL_Node *dead;         /**< Dead cell, the level 0 node */
+  HL_Node *alive;        /**< Alive cell, the level 0 node */
+  HL_Node *empty[64];    /**< Empty square of every level, NULL until used */
+  HL_Node *root;         /**< Square holding every alive cell */
+  int64_t row;           /**< Row of the north west corner of root */
+  int64_t col;           /**< Column of the north west corner of root */
+  int step;              /**< Results are memoized for steps of 2^step */
+  uint64_t generation;   /**< Number of generations computed so far */
+} HashLife;
+
+HashLife *HL_new(void);
+HashLife *HL_from_board(Board *board);
+Board *HL_to_board(HashLife *life, Board *board, int64_t row, int64_t col);
+HashLife *HL_step(HashLife *life, int k);
+HashLife *HL_advance(HashLife *life, uint64_t generations);
+void HL_set_alive(HashLife *life, int64_t row, int64_t col);
+int HL_is_alive(HashLife *life, int64_t row, int64_t col);
+uint64_t HL_population(HashLife *life);
+void HL_destroy(HashLife *life);
+#endif
@@ -0,0 +1,354 @@
+/**
+ * @file packed.c
+ * @brief Contains the bit-packed board and its word-parallel (SWAR) update
+ * kernel computing 64 cells per operation with bitwise adder logic
+ */
+#include <packed.h>
+#include <random.h>
+#include <simd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * Allocates a packed board with the given number of generations in its block
+ * followed by the kernel scratch rows, all reset
+ * @param height Heigth of the board
+ * @param width Width of the board
+ * @param version Rules of the board as either CLIPPED or CIRCULAR
+ * @param generations 2, or 1 when the current generation lives elsewhere
+ * @return Pointer to the packed board structure, bits and next both pointing
+ * to the start of the block
+ */
+static PackedBoard *_alloc(int height, int width, Version version,
+                           int generations) {
+  PackedBoard *packed = (PackedBoard *)malloc(sizeof(PackedBoard));
+  int words = (width + PB_WORD_BITS - 1) / PB_WORD_BITS;
+  size_t generation = (size_t)height * words;
+  size_t size =
+      (generations * generation + 6 * (size_t)words) * sizeof(uint64_t);
+  size = (size + B_ALIGNMENT - 1) / B_ALIGNMENT * B_ALIGNMENT;
+  uint64_t *block = (uint64_t *)aligned_alloc(B_ALIGNMENT, size);
+
+  if (packed == NULL || block == NULL) {
+    printf("PB_new: Could not allocate %dx%d board\nExiting...\n", height,
+           width);
+    exit(1);
+  }
+  memset(block, 0, size);
+  packed->height = height;
+  packed->width = width;
+  packed->version = version;
+  packed->words = words;
+  packed->bits = block;
+  packed->next = block;
+  packed->sums = block + generations * generation;
+  packed->block = block;
+  packed->mapping = NULL;
+  packed->mapped = 0;
+  packed->rule = RU_LIFE_BITS;
+  return packed;
+}
+
+/**
+ * Creates new reset (all cells are dead) packed board. Both generations and
+ * the kernel scratch rows share one aligned allocation.
+ * @param height Heigth of the board
+ * @param width Width of the board
+ * @param version Rules of the board as either CLIPPED or CIRCULAR
+ * @return Pointer to the packed board structure
+ */
+PackedBoard *PB_new(int height, int width, Version version) {
+  PackedBoard *packed = _alloc(height, width, version, 2);
+  packed->next = packed->block + (size_t)height * packed->words;
+  return packed;
+}
+
+/**
+ * Creates a packed board whose current generation is read in place from a
+ * private writable mapping. Only the back buffer and the scratch rows are
+ * allocated; the mapping stays one of the two generations until
+ * PB_destroy unmaps it, its pages being copied only when a step writes them.
+ * @param height Heigth of the board
+ * @param width Width of the board
+ * @param version Rules of the board as either CLIPPED or CIRCULAR
+ * @param bits The cells in the mapping, laid out like the rows of the board
+ * @param mapping Start of the mapping
+ * @param mapped Number of bytes of the mapping
+ * @return Pointer to the packed board structure
+ */
+PackedBoard *PB_map(int height, int width, Version version, uint64_t *bits,
+                    void *mapping, size_t mapped) {
+  PackedBoard *packed = _alloc(height, width, version, 1);
+  packed->bits = bits;
+  packed->mapping = mapping;
+  packed->mapped = mapped;
+  return packed;
+}
+
+/**
+ * Creates a packed board holding the current generation of the given board
+ * @param board Pointer to struct board
+ * @return Pointer to the new packed board structure
+ */
+PackedBoard *PB_from_board(Board *board) {
+  PackedBoard *packed = PB_new(board->height, board->width, board->version);
+  if (board->rule.states == 2)
+    packed->rule = board->rule.bits;
+  for (int i = 0; i < board->height; i++) {
+    const Cell *row = board->cell[i];
+    uint64_t *out = packed->bits + (size_t)i * packed->words;
+    for (int j = 0; j < board->width; j++)
+      if (B_is_alive(row[j]))
+        out[j / PB_WORD_BITS] |= (uint64_t)1 << (j % PB_WORD_BITS);
+  }
+  return packed;
+}
+
+/**
+ * Writes the current generation of the packed board into the given board
+ * @param packed Pointer to the packed board
+ * @param board Pointer to struct board of the same dimensions
+ * @return Pointer to struct board
+ */
+Board *PB_to_board(PackedBoard *packed, Board *board) {
+  for (int i = 0; i < packed->height; i++) {
+    const uint64_t *row = packed->bits + (size_t)i * packed->words;
+    Cell *out = board->cell[i];
+    for (int j = 0; j < packed->width; j++)
+      out[j] = (row[j / PB_WORD_BITS] >> (j % PB_WORD_BITS)) & 1 ? ALIVE : DEAD;
+  }
+  board->dirty = 1;
+  return board;
+}
+
+/**
+ * Computes the horizontal sums of every cell with its west and east
+ * neighbours for one row, as a two bit number per cell (h0 + 2 * h1)
+ * @param packed Pointer to the packed board
+ * @param i Row index, may be -1 or height for the row outside the board
+ * @param h0 Receives the low bits of the sums
+ * @param h1 Receives the high bits of the sums
+ */
+static void _horizontal_sums(PackedBoard *packed, int i, uint64_t *h0,
+                             uint64_t *h1) {
+  int words = packed->words;
+  int circular = packed->version == CIRCULAR;
+
+  if (i < 0 || i >= packed->height) {
+    if (!circular) {
+      memset(h0, 0, words * sizeof(uint64_t));
+      memset(h1, 0, words * sizeof(uint64_t));
+      return;
+    }
+    i = (i + packed->height) % packed->height;
+  }
+
+  const uint64_t *row = packed->bits + (size_t)i * words;
+  int last = (packed->width - 1) % PB_WORD_BITS;
+  uint64_t west_in = circular ? (row[words - 1] >> last) & 1 : 0;
+  uint64_t east_in = circular ? row[0] & 1 : 0;
+
+  // Only the edge words need the wrapped in bits, the rest is vectorized
+  uint64_t c = row[0];
+  PB_horizontal((c << 1) | west_in, c,
+                (c >> 1) | (words > 1 ? row[1] << 63 : east_in << last), &h0[0],
+                &h1[0]);
+  if (words > 1) {
+    c = row[words - 1];
+    PB_horizontal((c << 1) | (row[words - 2] >> 63), c,
+                  (c >> 1) | (east_in << last), &h0[words - 1],
+                  &h1[words - 1]);
+  }
+  if (words > 2)
+    PB_kernels()->horizontal(row, h0, h1, 1, words - 1);
+}
+
+/**
+ * Updates the packed board in place to the next time unit t + 1. Each row is
+ * reduced to horizontal sums once; three consecutive rows of sums are then
+ * added with bitwise full adders to get the 3x3 population of 64 cells at a
+ * time, or of 256 cells per instruction with the AVX2 kernels. Rules other
+ * than B3/S23 go through the truth table of PB_rule.
+ * @param packed Pointer to the packed board to be updated
+ * @return The same pointer to the packed board
+ */
+PackedBoard *PB_step(PackedBoard *packed) {
+  int words = packed->words;
+  const PB_Kernels *kernels = PB_kernels();
+  uint64_t *h0[3], *h1[3];
+  uint64_t tail = packed->width % PB_WORD_BITS
+                      ? ((uint64_t)1 << (packed->width % PB_WORD_BITS)) - 1
+                      : ~(uint64_t)0;
+
+  for (int s = 0; s < 3; s++) {
+    h0[s] = packed->sums + (2 * s) * (size_t)words;
+    h1[s] = packed->sums + (2 * s + 1) * (size_t)words;
+  }
+  _horizontal_sums(packed, -1, h0[0], h1[0]);
+  _horizontal_sums(packed, 0, h0[1], h1[1]);
+
+  for (int i = 0; i < packed->height; i++) {
+    int up = i % 3, mid = (i + 1) % 3, down = (i + 2) % 3;
+    const uint64_t *row = packed->bits + (size_t)i * words;
+    uint64_t *out = packed->next + (size_t)i * words;
+
+    _horizontal_sums(packed, i + 1, h0[down], h1[down]);
+    uint64_t *r0[3] = {h0[up], h0[mid], h0[down]};
+    uint64_t *r1[3] = {h1[up], h1[mid], h1[down]};
+    if (packed->rule == RU_LIFE_BITS) {
+      kernels->combine(r0, r1, row, out, words);
+    } else {
+      for (int k = 0; k < words; k++)
+        out[k] = PB_rule(r0[0][k], r1[0][k], r0[1][k], r1[1][k], r0[2][k],
+                         r1[2][k], row[k], packed->rule);
+    }
+    out[words - 1] &= tail;
+  }
+
+  uint64_t *bits = packed->bits;
+  packed->bits = packed->next;
+  packed->next = bits;
+  return packed;
+}
+
+/**
+ * Changes the rule applied by the next steps of the packed board
+ * @param packed Pointer to the packed board
+ * @param rule Pointer to the rule, which must have two states
+ * @return Pointer to the packed board, NULL if the rule has dying states
+ */
+PackedBoard *PB_set_rule(PackedBoard *packed, const Rule *rule) {
+  if (rule->states > 2) {
+    printf("PB_set_rule: The packed board only has two states\n");
+    return NULL;
+  }
+  packed->rule = rule->bits;
+  return packed;
+}
+
+/** Arguments of the generation of a packed board by bands of rows */
+typedef struct {
+  PackedBoard *packed;     /**< Board being generated */
+  uint32_t threshold;      /**< Draws below it give alive cells */
+  unsigned long long seed; /**< Seed of the random numbers */
+} PackedGenerateTask;
+
+/**
+ * Task of the thread pool generating one row band of the packed board, a
+ * whole word of cells at a time
+ * @param arg Pointer to the PackedGenerateTask
+ * @param band Index of the band generated by the calling thread
+ * @param bands Number of bands the board is split into
+ */
+static void _generate_band(void *arg, int band, int bands) {
+  PackedGenerateTask *task = (PackedGenerateTask *)arg;
+  PackedBoard *packed = task->packed;
+  int begin = (int)((long long)packed->height * band / bands);
+  int end = (int)((long long)packed->height * (band + 1) / bands);
+  uint64_t tail = packed->width % PB_WORD_BITS
+                      ? ((uint64_t)1 << (packed->width % PB_WORD_BITS)) - 1
+                      : ~(uint64_t)0;
+
+  for (int i = begin; i < end; i++) {
+    uint64_t *row = packed->bits + (size_t)i * packed->words;
+    for (int k = 0; k < packed->words; k++) {
+      uint64_t word = 0;
+      for (int c = 0; c < PB_WORD_BITS; c += R_CELLS) {
+        uint64_t r = R_random(task->seed, R_counter(i, k * PB_WORD_BITS + c));
+        for (int l = 0; l < R_CELLS; l++, r >>= 16)
+          word |= (uint64_t)((r & 0xFFFF) < task->threshold) << (c + l);
+      }
+      row[k] = word;
+    }
+    row[packed->words - 1] &= tail;
+  }
+}
+
+/**
+ * Generates random arrangement of dead and alive cells of the packed board.
+ * Cells are drawn exactly like B_generate_parallel draws them, so both give
+ * the same board for the same seed, whatever the number of threads.
+ * @param packed Pointer to the packed board
+ * @param p Probability of cell being alive. Range of p is [0; 100]. Otherwise
+ * print error to console and terminate the execution.
+ * @param seed Seed of the random numbers
+ * @param pool Pointer to the thread pool, NULL to use the calling thread
+ * @return Pointer to the packed board
+ */
+PackedBoard *PB_generate(PackedBoard *packed, int p, unsigned long long seed,
+                         ThreadPool *pool) {
+  if (p < 0 || p > 100) {
+    printf("Probability should be between 0 and 100");
+    exit(1);
+  }
+  PackedGenerateTask task = {packed, R_threshold(p), seed};
+  if (pool != NULL)
+    TP_run(pool, _generate_band, &task);
+  else
+    _generate_band(&task, 0, 1);
+  return packed;
+}
+
+/**
+ * Counts the alive cells of the packed board
+ * @param packed Pointer to the packed board
+ * @return Population
+ */
+uint64_t PB_population(PackedBoard *packed) {
+  uint64_t population = 0;
+  for (size_t k = 0; k < (size_t)packed->height * packed->words; k++)
+    population += (uint64_t)__builtin_popcountll(packed->bits[k]);
+  return population;
+}
+
+/**
+ * Frees the memory allocated by the given packed board.
+ * @param packed Pointer to the packed board
+ */
+void PB_destroy(PackedBoard *packed) {
+  if (packed == NULL) {
+    printf("PB_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  if (packed->mapping != NULL)
+    munmap(packed->mapping, packed->mapped);
+  free(packed->block);
+  free(packed);
+}
+
+/**
+ * Checks if the cell at given coordinates is alive
+ * @param packed Pointer to the packed board
+ * @param row integer representing the row coordinate of the cell
+ * @param col integer representing the column coordinate of the cell
+ * @return 1 If the cell is alive. Otherwise return 0.
+ */
+int PB_is_alive(PackedBoard *packed, int row, int col) {
+  const uint64_t *word =
+      packed->bits + (size_t)row * packed->words + col / PB_WORD_BITS;
+  return (int)((*word >> (col % PB_WORD_BITS)) & 1);
+}
+
+/**
+ * Makes the cell at given coordinates alive
+ * @param packed Pointer to the packed board
+ * @param row integer representing the row coordinate of the cell
+ * @param col integer representing the column coordinate of the cell
+ */
+void PB_set_alive(PackedBoard *packed, int row, int col) {
+  packed->bits[(size_t)row * packed->words + col / PB_WORD_BITS] |=
+      (uint64_t)1 << (col % PB_WORD_BITS);
+}
+
+/**
+ * Makes the cell at given coordinates dead
+ * @param packed Pointer to the packed board
+ * @param row integer representing the row coordinate of the cell
+ * @param col integer representing the column coordinate of the cell
+ */
+void PB_set_dead(PackedBoard *packed, int row, int col) {
+  packed->bits[(size_t)row * packed->words + col / PB_WORD_BITS] &=
+      ~((uint64_t)1 << (col % PB_WORD_BITS));
+}
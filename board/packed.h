@@ -0,0 +1,129 @@
+/**
+ * @file packed.h
+ * @brief Header file for the bit-packed board (one bit per cell) and its
+ * word-parallel update kernel
+ */
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <board.h>
+#include <stdint.h>
+
+/** Number of cells stored in one word of a packed row */
+#define PB_WORD_BITS (64)
+
+/** Packed board struct. Row i occupies words consecutive 64-bit words, cell
+ * (i, j) being bit j % 64 of word j / 64. Bits past the last column are kept
+ * at zero. One of the two generations may live in a private mapping of a
+ * snapshot file, read in place and kept until PB_destroy. */
+typedef struct {
+  int height;      /**< Represents height of the board */
+  int width;       /**< Represents width of the board */
+  Version version; /**< Represents the rules of the board as either CLIPPED or
+                      CIRCULAR */
+  int words;       /**< Number of 64-bit words per row */
+  uint64_t *bits;  /**< Current generation, height * words words */
+  uint64_t *next;  /**< Back buffer receiving the next generation */
+  uint64_t *sums;  /**< Scratch space for three rows of horizontal sums */
+  uint64_t *block; /**< Allocation holding the generations that are not
+                      mapped and the sums */
+  void *mapping;   /**< Mapped file holding one generation, NULL if none */
+  size_t mapped;   /**< Number of bytes of the mapping */
+  uint32_t rule;   /**< Truth table of the two state rule, see Rule */
+} PackedBoard;
+
+/**
+ * Horizontal sums of 64 cells with their west and east neighbours, as a two
+ * bit number per cell (h0 + 2 * h1)
+ * @param w The cells shifted so that every bit holds its west neighbour
+ * @param c The cells
+ * @param e The cells shifted so that every bit holds its east neighbour
+ * @param h0 Receives the low bits of the sums
+ * @param h1 Receives the high bits of the sums
+ */
+static inline void PB_horizontal(uint64_t w, uint64_t c, uint64_t e,
+                                 uint64_t *h0, uint64_t *h1) {
+  *h0 = w ^ c ^ e;
+  *h1 = (w & c) | (e & (w ^ c));
+}
+
+/**
+ * Adds the horizontal sums of three rows with bitwise full adders and applies
+ * the rule to 64 cells at once
+ * @param a0 Low bits of the sums of the row above
+ * @param a1 High bits of the sums of the row above
+ * @param b0 Low bits of the sums of the row itself
+ * @param b1 High bits of the sums of the row itself
+ * @param c0 Low bits of the sums of the row below
+ * @param c1 High bits of the sums of the row below
+ * @param alive The cells of the current generation
+ * @return The cells of the next generation
+ */
+static inline uint64_t PB_life(uint64_t a0, uint64_t a1, uint64_t b0,
+                               uint64_t b1, uint64_t c0, uint64_t c1,
+                               uint64_t alive) {
+  // Population of the 3x3 block is x + 2 * (a1 + b1 + c1 + carry)
+  uint64_t x = a0 ^ b0 ^ c0;
+  uint64_t carry = (a0 & b0) | (c0 & (a0 ^ b0));
+  uint64_t p = a1 ^ b1, q = a1 & b1;
+  uint64_t r = c1 ^ carry, u = c1 & carry;
+  uint64_t twos_is_one = (p ^ r) & ~(q | u);
+  uint64_t twos_is_two = (p & r) | (~(p | r) & (q ^ u));
+
+  // Alive with a 3x3 population of 3, or of 4 if the cell itself is alive
+  return (x & twos_is_one) | (~x & twos_is_two & alive);
+}
+
+/**
+ * Applies any two state rule to 64 cells at once. The 3x3 population is
+ * added into four bits and every entry of the truth table of the rule that
+ * gives an alive cell is matched against those bits and the cell.
+ * @param a0 Low bits of the sums of the row above
+ * @param a1 High bits of the sums of the row above
+ * @param b0 Low bits of the sums of the row itself
+ * @param b1 High bits of the sums of the row itself
+ * @param c0 Low bits of the sums of the row below
+ * @param c1 High bits of the sums of the row below
+ * @param alive The cells of the current generation
+ * @param rule Truth table of the rule, see Rule
+ * @return The cells of the next generation
+ */
+static inline uint64_t PB_rule(uint64_t a0, uint64_t a1, uint64_t b0,
+                               uint64_t b1, uint64_t c0, uint64_t c1,
+                               uint64_t alive, uint32_t rule) {
+  // Population of the 3x3 block is s0 + 2 * s1 + 4 * s2 + 8 * s3
+  uint64_t s0 = a0 ^ b0 ^ c0;
+  uint64_t carry = (a0 & b0) | (c0 & (a0 ^ b0));
+  uint64_t p = a1 ^ b1, q = a1 & b1;
+  uint64_t r = c1 ^ carry, u = c1 & carry;
+  uint64_t s1 = p ^ r, k = p & r;
+  uint64_t s2 = q ^ u ^ k;
+  uint64_t s3 = (q & u) | ((q ^ u) & k);
+  uint64_t next = 0;
+
+  for (; rule != 0; rule &= rule - 1) {
+    int n = __builtin_ctz(rule);
+    // All ones where the bit of the entry is set
+    uint64_t m0 = -(uint64_t)(n & 1), m1 = -(uint64_t)((n >> 1) & 1);
+    uint64_t m2 = -(uint64_t)((n >> 2) & 1), m3 = -(uint64_t)((n >> 3) & 1);
+    uint64_t ma = -(uint64_t)(n >> 4);
+    next |= ~((s0 ^ m0) | (s1 ^ m1) | (s2 ^ m2) | (s3 ^ m3) | (alive ^ ma));
+  }
+  return next;
+}
+
+PackedBoard *PB_new(int height, int width, Version version);
+PackedBoard *PB_map(int height, int width, Version version, uint64_t *bits,
+                    void *mapping, size_t mapped);
+PackedBoard *PB_from_board(Board *board);
+Board *PB_to_board(PackedBoard *packed, Board *board);
+PackedBoard *PB_step(PackedBoard *packed);
+PackedBoard *PB_set_rule(PackedBoard *packed, const Rule *rule);
+PackedBoard *PB_generate(PackedBoard *packed, int p, unsigned long long seed,
+                         ThreadPool *pool);
+uint64_t PB_population(PackedBoard *packed);
+void PB_destroy(PackedBoard *packed);
+int PB_is_alive(PackedBoard *packed, int row, int col);
+void PB_set_alive(PackedBoard *packed, int row, int col);
+void PB_set_dead(PackedBoard *packed, int row, int col);
+#endif
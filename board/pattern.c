@@ -0,0 +1,487 @@
+/**
+ * @file pattern.c
+ * @brief Contains the readers and writers of pattern files. Readers go
+ * through the file one character at a time and hand every run of alive
+ * cells to a sink, so files of any size are read without keeping their text
+ * and RLE runs are written straight into the board.
+ */
+#include <ctype.h>
+#include <pattern.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Largest run length or coordinate read, longer ones are cut */
+#define PT_MAX (1LL << 40)
+
+/** Bounding box of the cells of a pattern, see PT_bounds */
+typedef struct {
+  int64_t top, left, bottom, right; /**< Bounds, bottom and right excluded */
+  int empty;                        /**< 1 until a cell was found */
+} PT_Box;
+
+/**
+ * Skips the rest of the current line
+ * @param file The file
+ * @return The newline, or EOF
+ */
+static int _skip_line(FILE *file) {
+  int c;
+  while ((c = getc(file)) != EOF && c != '\n')
+    ;
+  return c;
+}
+
+/**
+ * Reads a run length encoded pattern. Lines starting with # and the header
+ * line are skipped; b and . are dead cells, other letters alive ones, $ ends
+ * a row and ! the pattern.
+ * @param file The file
+ * @param sink Receives the runs of alive cells
+ * @param target Argument of the sink
+ * @param row Row of the top left cell of the pattern
+ * @param col Column of the top left cell of the pattern
+ * @return 0
+ */
+static int _read_rle(FILE *file, PT_Sink sink, void *target, int64_t row,
+                     int64_t col) {
+  int64_t count = 0, i = 0, j = 0;
+  int c, start = 1, body = 0;
+
+  while ((c = getc(file)) != EOF && c != '!') {
+    if (start && (c == '#' || (c == 'x' && !body))) {
+      _skip_line(file);
+      continue;
+    }
+    start = c == '\n';
+    if (isdigit(c)) {
+      count = count < PT_MAX ? count * 10 + (c - '0') : PT_MAX;
+      continue;
+    }
+    if (isspace(c))
+      continue;
+
+    int64_t n = count > 0 ? count : 1;
+    body = 1;
+    count = 0;
+    if (c == '$') {
+      i += n;
+      j = 0;
+    } else if (c == 'b' || c == '.') {
+      j += n;
+    } else if (isalpha(c)) {
+      sink(target, row + i, col + j, n);
+      j += n;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Reads a plaintext pattern. Lines starting with ! are comments, every
+ * other line is a row where O or * are alive cells.
+ * @param file The file
+ * @param sink Receives the runs of alive cells
+ * @param target Argument of the sink
+ * @param row Row of the top left cell of the pattern
+ * @param col Column of the top left cell of the pattern
+ * @return 0
+ */
+static int _read_cells(FILE *file, PT_Sink sink, void *target, int64_t row,
+                       int64_t col) {
+  int64_t i = 0, j = 0, run = 0;
+  int c;
+
+  while ((c = getc(file)) != EOF) {
+    if (j == 0 && run == 0 && c == '!') {
+      _skip_line(file);
+      continue;
+    }
+    if (c == 'O' || c == '*') {
+      run++;
+      continue;
+    }
+    if (run > 0)
+      sink(target, row + i, col + j, run);
+    j += run;
+    run = 0;
+    if (c == '\n') {
+      i++;
+      j = 0;
+    } else if (c != '\r') {
+      j++;
+    }
+  }
+  if (run > 0)
+    sink(target, row + i, col + j, run);
+  return 0;
+}
+
+/**
+ * Reads a Life 1.06 pattern: lines starting with # are skipped and every
+ * other one holds the column and the row of an alive cell
+ * @param file The file
+ * @param sink Receives the alive cells
+ * @param target Argument of the sink
+ * @param row Row of the origin of the pattern
+ * @param col Column of the origin of the pattern
+ * @return 0 on success, -1 on a line that is not a pair of numbers
+ */
+static int _read_life106(FILE *file, PT_Sink sink, void *target, int64_t row,
+                         int64_t col) {
+  long long x, y;
+  int c;
+
+  while ((c = getc(file)) != EOF) {
+    if (c == '#') {
+      _skip_line(file);
+      continue;
+    }
+    if (isspace(c))
+      continue;
+    ungetc(c, file);
+    if (fscanf(file, "%lld %lld", &x, &y) != 2)
+      return -1;
+    if (x > -PT_MAX && x < PT_MAX && y > -PT_MAX && y < PT_MAX)
+      sink(target, row + y, col + x, 1);
+  }
+  return 0;
+}
+
+/**
+ * Finds the format of a pattern file from its extension, or else from its
+ * first line
+ * @param path Path of the file
+ * @return Format of the file, PT_UNKNOWN if it cannot be opened
+ */
+PatternFormat PT_format(const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (dot != NULL && strcmp(dot, ".rle") == 0)
+    return PT_RLE;
+  if (dot != NULL && strcmp(dot, ".cells") == 0)
+    return PT_CELLS;
+  if (dot != NULL && (strcmp(dot, ".lif") == 0 || strcmp(dot, ".life") == 0))
+    return PT_LIFE106;
+
+  FILE *file = fopen(path, "r");
+  char line[64] = "";
+  if (file == NULL)
+    return PT_UNKNOWN;
+  PatternFormat format = PT_CELLS;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (strncmp(line, "#Life 1.06", 10) == 0) {
+      format = PT_LIFE106;
+      break;
+    }
+    // RLE comments also start with #, its header with x =
+    if (line[0] == '#')
+      format = PT_RLE;
+    else {
+      if (line[0] == 'x' || strchr(line, '$') != NULL ||
+          (strchr(line, '!') != NULL && line[0] != '!'))
+        format = PT_RLE;
+      break;
+    }
+  }
+  fclose(file);
+  return format;
+}
+
+/**
+ * Reads a pattern file and hands its alive cells to a sink
+ * @param path Path of the file
+ * @param sink Receives the runs of alive cells
+ * @param target Argument of the sink
+ * @param row Row of the top left cell of the pattern, or of the origin of a
+ * Life 1.06 pattern
+ * @param col Column of the top left cell of the pattern
+ * @return 0 on success, -1 otherwise
+ */
+int PT_read(const char *path, PT_Sink sink, void *target, int64_t row,
+            int64_t col) {
+  PatternFormat format = PT_format(path);
+  FILE *file = format == PT_UNKNOWN ? NULL : fopen(path, "r");
+  if (file == NULL) {
+    printf("PT_read: Could not read %s\n", path);
+    return -1;
+  }
+  int result = format == PT_RLE     ? _read_rle(file, sink, target, row, col)
+               : format == PT_CELLS ? _read_cells(file, sink, target, row, col)
+                                    : _read_life106(file, sink, target, row,
+                                                    col);
+  fclose(file);
+  if (result != 0)
+    printf("PT_read: %s is not a valid pattern\n", path);
+  return result;
+}
+
+/**
+ * Sink writing alive cells into a Board. A CIRCULAR board wraps the pattern
+ * around, the other versions drop the cells that are out of the board.
+ * @param target Pointer to the struct Board
+ * @param row Row of the first cell
+ * @param col Column of the first cell
+ * @param count Number of alive cells
+ */
+static void _board_sink(void *target, int64_t row, int64_t col,
+                        int64_t count) {
+  Board *board = (Board *)target;
+  if (board->version == CIRCULAR) {
+    int64_t i = (row % board->height + board->height) % board->height;
+    if (count > board->width)
+      count = board->width;
+    for (int64_t k = 0; k < count; k++)
+      board->cell[i][((col + k) % board->width + board->width) %
+                     board->width] = ALIVE;
+  } else if (row >= 0 && row < board->height) {
+    int64_t end = col + count < board->width ? col + count : board->width;
+    for (int64_t j = col > 0 ? col : 0; j < end; j++)
+      board->cell[row][j] = ALIVE;
+  }
+  board->dirty = 1;
+}
+
+/**
+ * Sink writing alive cells into a SparseBoard
+ * @param target Pointer to the SparseBoard
+ * @param row Row of the first cell
+ * @param col Column of the first cell
+ * @param count Number of alive cells
+ */
+static void _sparse_sink(void *target, int64_t row, int64_t col,
+                         int64_t count) {
+  for (int64_t k = 0; k < count; k++)
+    SB_set_alive((SparseBoard *)target, row, col + k);
+}
+
+/**
+ * Sink growing a bounding box over the alive cells
+ * @param target Pointer to the PT_Box
+ * @param row Row of the first cell
+ * @param col Column of the first cell
+ * @param count Number of alive cells
+ */
+static void _box_sink(void *target, int64_t row, int64_t col, int64_t count) {
+  PT_Box *box = (PT_Box *)target;
+  if (box->empty || row < box->top)
+    box->top = row;
+  if (box->empty || row + 1 > box->bottom)
+    box->bottom = row + 1;
+  if (box->empty || col < box->left)
+    box->left = col;
+  if (box->empty || col + count > box->right)
+    box->right = col + count;
+  box->empty = 0;
+}
+
+/**
+ * Sets the cells of a pattern file alive in a board, the other cells being
+ * left as they are
+ * @param path Path of the file
+ * @param board Pointer to the struct Board
+ * @param row Row of the top left cell of the pattern
+ * @param col Column of the top left cell of the pattern
+ * @return 0 on success, -1 otherwise
+ */
+int PT_load(const char *path, Board *board, int64_t row, int64_t col) {
+  return PT_read(path, _board_sink, board, row, col);
+}
+
+/**
+ * Sets the cells of a pattern file alive on an unbounded plane
+ * @param path Path of the file
+ * @param sparse Pointer to the SparseBoard
+ * @param row Row of the top left cell of the pattern
+ * @param col Column of the top left cell of the pattern
+ * @return 0 on success, -1 otherwise
+ */
+int PT_load_sparse(const char *path, SparseBoard *sparse, int64_t row,
+                   int64_t col) {
+  return PT_read(path, _sparse_sink, sparse, row, col);
+}
+
+/**
+ * Finds the bounding box of the alive cells of a pattern file placed at the
+ * origin
+ * @param path Path of the file
+ * @param top Receives the first row with an alive cell
+ * @param left Receives the first column with an alive cell
+ * @param height Receives the number of rows of the box, 0 if no cell is alive
+ * @param width Receives the number of columns of the box
+ * @return 0 on success, -1 otherwise
+ */
+int PT_bounds(const char *path, int64_t *top, int64_t *left, int64_t *height,
+              int64_t *width) {
+  PT_Box box = {0, 0, 0, 0, 1};
+  if (PT_read(path, _box_sink, &box, 0, 0) != 0)
+    return -1;
+  *top = box.top;
+  *left = box.left;
+  *height = box.bottom - box.top;
+  *width = box.right - box.left;
+  return 0;
+}
+
+/**
+ * Reads the rule of the header line of an RLE file, as written by PT_save
+ * @param path Path of the file
+ * @param rule Receives the rule when the file gives one
+ * @return 1 if the rule was read, 0 if the file is not RLE or gives no rule,
+ * -1 if it cannot be read or gives a rule that is not known
+ */
+int PT_rule(const char *path, Rule *rule) {
+  if (PT_format(path) != PT_RLE)
+    return 0;
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("PT_rule: Could not read %s\n", path);
+    return -1;
+  }
+  char line[256], name[RU_NAME];
+  int found = 0;
+  // The header is the first line that is not a comment
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    char *field = line[0] == 'x' ? strstr(line, "rule") : NULL;
+    if (field != NULL)
+      found = sscanf(field, "rule = %39[^, \t\r\n]", name) == 1;
+    break;
+  }
+  fclose(file);
+  if (!found)
+    return 0;
+  if (RU_parse(rule, name) != 0) {
+    printf("PT_rule: Unknown rule %s in %s\n", name, path);
+    return -1;
+  }
+  return 1;
+}
+
+/**
+ * Writes a run of an RLE file, wrapping the lines
+ * @param file The file
+ * @param length Length of the current line, updated
+ * @param count Length of the run
+ * @param tag b, o or $
+ */
+static void _put_run(FILE *file, int *length, int64_t count, char tag) {
+  char run[32];
+  int n = count > 1 ? snprintf(run, sizeof(run), "%lld%c", (long long)count, tag)
+                    : snprintf(run, sizeof(run), "%c", tag);
+  if (*length + n > PT_RLE_LINE) {
+    putc('\n', file);
+    *length = 0;
+  }
+  fputs(run, file);
+  *length += n;
+}
+
+/**
+ * Writes a board as an RLE pattern, rows being ended at their last alive
+ * cell and runs of empty rows merged. The header gives the rule of the board.
+ * @param file The file
+ * @param board Pointer to the struct Board
+ */
+static void _write_rle(FILE *file, Board *board) {
+  int length = 0;
+  int64_t rows = 0;
+  char rule[RU_NAME];
+
+  RU_format(&board->rule, rule, sizeof(rule));
+  fprintf(file, "x = %d, y = %d, rule = %s\n", board->width, board->height,
+          rule);
+  for (int i = 0; i < board->height; i++) {
+    const Cell *cells = board->cell[i];
+    int last = board->width - 1;
+    while (last >= 0 && !B_is_alive(cells[last]))
+      last--;
+    if (last < 0) {
+      rows++;
+      continue;
+    }
+    if (rows > 0)
+      _put_run(file, &length, rows, '$');
+    for (int j = 0; j <= last;) {
+      int k = j;
+      while (k <= last && B_is_alive(cells[k]) == B_is_alive(cells[j]))
+        k++;
+      _put_run(file, &length, k - j, B_is_alive(cells[j]) ? 'o' : 'b');
+      j = k;
+    }
+    rows = 1;
+  }
+  fputs("!\n", file);
+}
+
+/**
+ * Writes a board as a plaintext pattern, rows being ended at their last
+ * alive cell
+ * @param file The file
+ * @param board Pointer to the struct Board
+ */
+static void _write_cells(FILE *file, Board *board) {
+  fprintf(file, "!Name: %dx%d board\n", board->height, board->width);
+  for (int i = 0; i < board->height; i++) {
+    const Cell *cells = board->cell[i];
+    int last = board->width - 1;
+    while (last >= 0 && !B_is_alive(cells[last]))
+      last--;
+    for (int j = 0; j <= last; j++)
+      putc(B_is_alive(cells[j]) ? 'O' : '.', file);
+    putc('\n', file);
+  }
+}
+
+/**
+ * Writes the alive cells of a board as a Life 1.06 pattern
+ * @param file The file
+ * @param board Pointer to the struct Board
+ */
+static void _write_life106(FILE *file, Board *board) {
+  fputs("#Life 1.06\n", file);
+  for (int i = 0; i < board->height; i++)
+    for (int j = 0; j < board->width; j++)
+      if (B_is_alive(board->cell[i][j]))
+        fprintf(file, "%d %d\n", j, i);
+}
+
+/**
+ * Writes the current generation of a board into a pattern file
+ * @param path Path of the file, replaced if it exists
+ * @param board Pointer to the struct Board
+ * @param format Format of the file, PT_UNKNOWN to choose it from the
+ * extension of the path with RLE by default
+ * @return 0 on success, -1 otherwise, also when the rule of the board has
+ * dying states: the files only hold alive and dead cells
+ */
+int PT_save(const char *path, Board *board, PatternFormat format) {
+  if (board->rule.states > 2) {
+    printf("PT_save: Dying states cannot be written to %s\n", path);
+    return -1;
+  }
+  if (format == PT_UNKNOWN) {
+    const char *dot = strrchr(path, '.');
+    format = dot != NULL && strcmp(dot, ".cells") == 0 ? PT_CELLS
+             : dot != NULL && (strcmp(dot, ".lif") == 0 ||
+                               strcmp(dot, ".life") == 0)
+                 ? PT_LIFE106
+                 : PT_RLE;
+  }
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    printf("PT_save: Could not create %s\n", path);
+    return -1;
+  }
+  if (format == PT_RLE)
+    _write_rle(file, board);
+  else if (format == PT_CELLS)
+    _write_cells(file, board);
+  else
+    _write_life106(file, board);
+  if (fclose(file) != 0) {
+    printf("PT_save: Could not write %s\n", path);
+    return -1;
+  }
+  return 0;
+}
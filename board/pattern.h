@@ -0,0 +1,39 @@
+/**
+ * @file pattern.h
+ * @brief Header file for reading and writing the usual pattern files: RLE,
+ * plaintext .cells and Life 1.06
+ */
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <board.h>
+#include <sparse.h>
+#include <stdint.h>
+
+/** Longest line written in an RLE file */
+#define PT_RLE_LINE (70)
+
+/** Formats of pattern files */
+typedef enum {
+  PT_RLE,     /**< Run length encoded, the usual format of pattern files */
+  PT_CELLS,   /**< Plaintext, one character per cell */
+  PT_LIFE106, /**< Coordinates of the alive cells, one per line */
+  PT_UNKNOWN  /**< Not a pattern file */
+} PatternFormat;
+
+/** Receives every run of count alive cells of a pattern, starting at the
+ * given cell and going right */
+typedef void (*PT_Sink)(void *target, int64_t row, int64_t col,
+                        int64_t count);
+
+PatternFormat PT_format(const char *path);
+int PT_read(const char *path, PT_Sink sink, void *target, int64_t row,
+            int64_t col);
+int PT_load(const char *path, Board *board, int64_t row, int64_t col);
+int PT_load_sparse(const char *path, SparseBoard *sparse, int64_t row,
+                   int64_t col);
+int PT_bounds(const char *path, int64_t *top, int64_t *left, int64_t *height,
+              int64_t *width);
+int PT_rule(const char *path, Rule *rule);
+int PT_save(const char *path, Board *board, PatternFormat format);
+#endif
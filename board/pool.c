@@ -0,0 +1,155 @@
+/**
+ * @file pool.c
+ * @brief Contains the persistent pool of worker threads. Workers sleep on a
+ * barrier between runs, so no thread is created while stepping.
+ */
+#include <pool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Arguments given to every worker thread */
+typedef struct {
+  ThreadPool *pool; /**< Pool the worker belongs to */
+  int band;         /**< Band of the worker, from 1 to threads - 1 */
+} TP_Worker;
+
+/**
+ * Initializes a barrier for the given number of threads
+ * @param barrier Pointer to the barrier
+ * @param count Number of threads that have to arrive to open it
+ */
+static void _barrier_init(TP_Barrier *barrier, int count) {
+  pthread_mutex_init(&barrier->mutex, NULL);
+  pthread_cond_init(&barrier->cond, NULL);
+  barrier->count = count;
+  barrier->waiting = 0;
+  barrier->phase = 0;
+}
+
+/**
+ * Blocks until count threads have called it
+ * @param barrier Pointer to the barrier
+ */
+static void _barrier_wait(TP_Barrier *barrier) {
+  pthread_mutex_lock(&barrier->mutex);
+  unsigned long phase = barrier->phase;
+  if (++barrier->waiting == barrier->count) {
+    barrier->waiting = 0;
+    barrier->phase++;
+    pthread_cond_broadcast(&barrier->cond);
+  } else {
+    while (phase == barrier->phase)
+      pthread_cond_wait(&barrier->cond, &barrier->mutex);
+  }
+  pthread_mutex_unlock(&barrier->mutex);
+}
+
+/**
+ * Frees the resources of a barrier
+ * @param barrier Pointer to the barrier
+ */
+static void _barrier_destroy(TP_Barrier *barrier) {
+  pthread_cond_destroy(&barrier->cond);
+  pthread_mutex_destroy(&barrier->mutex);
+}
+
+/**
+ * Main loop of a worker thread: wait for a task, run its band, report done
+ * @param arg Pointer to the TP_Worker of the thread
+ * @return NULL
+ */
+static void *_worker(void *arg) {
+  TP_Worker *worker = (TP_Worker *)arg;
+  ThreadPool *pool = worker->pool;
+  int band = worker->band;
+
+  free(worker);
+  while (1) {
+    _barrier_wait(&pool->start);
+    if (pool->quit)
+      break;
+    pool->task(pool->arg, band, pool->threads);
+    _barrier_wait(&pool->done);
+  }
+  return NULL;
+}
+
+/**
+ * Creates a pool and starts its worker threads
+ * @param threads Total number of threads, including the calling one. Values
+ * below 1 are treated as 1.
+ * @return Pointer to the thread pool
+ */
+ThreadPool *TP_new(int threads) {
+  ThreadPool *pool = (ThreadPool *)malloc(sizeof(ThreadPool));
+  if (threads < 1)
+    threads = 1;
+  if (pool == NULL) {
+    printf("TP_new: Could not allocate the pool\nExiting...\n");
+    exit(1);
+  }
+  pool->threads = threads;
+  pool->workers = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  pool->task = NULL;
+  pool->arg = NULL;
+  pool->quit = 0;
+  _barrier_init(&pool->start, threads);
+  _barrier_init(&pool->done, threads);
+
+  for (int t = 1; t < threads; t++) {
+    TP_Worker *worker = (TP_Worker *)malloc(sizeof(TP_Worker));
+    worker->pool = pool;
+    worker->band = t;
+    if (pthread_create(&pool->workers[t], NULL, _worker, worker) != 0) {
+      printf("TP_new: Could not start thread %d\nExiting...\n", t);
+      exit(1);
+    }
+  }
+  return pool;
+}
+
+/**
+ * Runs the task on every thread of the pool and waits for all of them. The
+ * barriers make the writes of one run visible to the next one.
+ * @param pool Pointer to the thread pool
+ * @param task Function run once per band
+ * @param arg Argument passed to the task
+ */
+void TP_run(ThreadPool *pool, TP_Task task, void *arg) {
+  if (pool->threads == 1) {
+    task(arg, 0, 1);
+    return;
+  }
+  pool->task = task;
+  pool->arg = arg;
+  _barrier_wait(&pool->start);
+  task(arg, 0, pool->threads);
+  _barrier_wait(&pool->done);
+}
+
+/**
+ * Returns the number of threads of the pool, 1 for a NULL pool
+ * @param pool Pointer to the thread pool or NULL
+ * @return Number of threads including the calling one
+ */
+int TP_threads(ThreadPool *pool) { return pool == NULL ? 1 : pool->threads; }
+
+/**
+ * Stops the worker threads and frees the pool
+ * @param pool Pointer to the thread pool
+ */
+void TP_destroy(ThreadPool *pool) {
+  if (pool == NULL) {
+    printf("TP_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  pool->quit = 1;
+  if (pool->threads > 1)
+    _barrier_wait(&pool->start);
+  for (int t = 1; t < pool->threads; t++)
+    pthread_join(pool->workers[t], NULL);
+  _barrier_destroy(&pool->start);
+  _barrier_destroy(&pool->done);
+  free(pool->workers);
+  free(pool);
+}
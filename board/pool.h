@@ -0,0 +1,41 @@
+/**
+ * @file pool.h
+ * @brief Header file for the persistent pool of worker threads used to step
+ * boards in parallel
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+
+/** Work run by every thread of the pool. Thread number band out of bands
+ * takes its share of the work described by arg. */
+typedef void (*TP_Task)(void *arg, int band, int bands);
+
+/** Reusable barrier made of a mutex and a condition variable, since
+ * pthread_barrier_t is not available everywhere */
+typedef struct {
+  pthread_mutex_t mutex; /**< Protects the fields below */
+  pthread_cond_t cond;   /**< Signaled when the last thread arrives */
+  int count;             /**< Number of threads to wait for */
+  int waiting;           /**< Number of threads arrived so far */
+  unsigned long phase;   /**< Incremented every time the barrier opens */
+} TP_Barrier;
+
+/** Pool of threads created once and reused for every generation. The calling
+ * thread takes part as band 0, so a pool of n threads starts n - 1 workers. */
+typedef struct {
+  int threads;        /**< Total number of threads including the caller */
+  pthread_t *workers; /**< The threads - 1 worker threads */
+  TP_Barrier start;   /**< Releases the workers on a new task */
+  TP_Barrier done;    /**< Waits for every band of the task to finish */
+  TP_Task task;       /**< Task of the current run */
+  void *arg;          /**< Argument of the current run */
+  int quit;           /**< Set to make the workers exit */
+} ThreadPool;
+
+ThreadPool *TP_new(int threads);
+void TP_run(ThreadPool *pool, TP_Task task, void *arg);
+void TP_destroy(ThreadPool *pool);
+int TP_threads(ThreadPool *pool);
+#endif
@@ -0,0 +1,52 @@
+/**
+ * @file random.h
+ * @brief Header file for the counter-based random numbers used to generate
+ * boards. A number only depends on the seed and its counter, so any part of
+ * a board can be generated independently and in any order.
+ */
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+/** Number of cells drawn from one random number, 16 bits each */
+#define R_CELLS (4)
+
+/**
+ * Returns the random number of the given counter, two rounds of the
+ * SplitMix64 finalizer keyed with the seed
+ * @param seed Seed of the sequence
+ * @param counter Position in the sequence
+ * @return Random 64-bit number
+ */
+static inline uint64_t R_random(uint64_t seed, uint64_t counter) {
+  uint64_t x = counter * 0x9E3779B97F4A7C15ULL + seed;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= (x >> 31) ^ seed;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Returns the counter of the random number drawing the given cell: the row
+ * and the group of R_CELLS columns. Boards of any layout thus get the same
+ * cells from the same seed.
+ * @param row Row of the cell
+ * @param col Column of the cell
+ * @return Counter for R_random
+ */
+static inline uint64_t R_counter(int row, int col) {
+  return ((uint64_t)(uint32_t)row << 32) | (uint32_t)(col / R_CELLS);
+}
+
+/**
+ * Converts a probability in percent into a threshold for 16-bit draws
+ * @param p Probability of a cell being alive, from 0 to 100
+ * @return Threshold, a draw below it is an alive cell
+ */
+static inline uint32_t R_threshold(int p) {
+  return (uint32_t)(((uint64_t)p << 16) / 100);
+}
+#endif
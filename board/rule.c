@@ -0,0 +1,154 @@
+/**
+ * @file rule.c
+ * @brief Contains the parser of the rule strings and the compilation of the
+ * rules into the tables read by the update kernels
+ */
+#include <ctype.h>
+#include <rule.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Sets a rule and compiles its transition tables
+ * @param rule Pointer to the rule
+ * @param birth Bit n set: a dead cell with n alive neighbours is born
+ * @param survival Bit n set: an alive cell with n alive neighbours survives
+ * @param states Number of states, between 2 and RU_STATES
+ * @return Pointer to the rule
+ */
+Rule *RU_make(Rule *rule, uint16_t birth, uint16_t survival, int states) {
+  rule->birth = birth & 0x1FF;
+  rule->survival = survival & 0x1FF;
+  rule->states = states;
+  rule->bits = 0;
+  memset(rule->next, 0, sizeof(rule->next));
+
+  for (int population = 0; population < 10; population++) {
+    // An alive cell counts itself in the 3x3 population
+    int born = (rule->birth >> population) & 1;
+    int kept = population > 0 && (rule->survival >> (population - 1)) & 1;
+    rule->next[0][population] = (unsigned char)born;
+    rule->next[1][population] =
+        (unsigned char)(kept ? 1 : states > 2 ? 2 : 0);
+    for (int state = 2; state < states; state++)
+      rule->next[state][population] =
+          (unsigned char)(state + 1 < states ? state + 1 : 0);
+    rule->bits |= (uint32_t)born << population;
+    rule->bits |= (uint32_t)kept << (16 + population);
+  }
+  return rule;
+}
+
+/**
+ * Reads the digits of a neighbour count list
+ * @param text The digits, the string going on after them
+ * @param end Receives the first character after the digits
+ * @return Bit n set for every digit n, -1 on a digit above 8
+ */
+static int _counts(const char *text, const char **end) {
+  int counts = 0;
+  for (; isdigit((unsigned char)*text); text++) {
+    if (*text > '8')
+      return -1;
+    counts |= 1 << (*text - '0');
+  }
+  *end = text;
+  return counts;
+}
+
+/**
+ * Parses a rule written as B3/S23, with a third part C3 or G3 giving the
+ * number of states of a Generations rule (as in B2/S/C3), or in the older
+ * S/B order without letters (23/3, 345/2/4). Case is ignored.
+ * @param rule Pointer to the rule receiving the parsed one
+ * @param text The rule string
+ * @return 0 on success, -1 if the string is not a rule, the rule being left
+ * as it was
+ */
+int RU_parse(Rule *rule, const char *text) {
+  int birth = 0, survival = 0, states = 2, part = 0, seen = 0;
+  const char *at = text;
+
+  while (*at != '\0') {
+    char tag = (char)toupper((unsigned char)*at);
+    const char *end;
+    if (tag == 'B' || tag == 'S') {
+      int counts = _counts(at + 1, &end);
+      if (counts < 0 || (seen & (tag == 'B' ? 1 : 2)))
+        break;
+      seen |= tag == 'B' ? 1 : 2;
+      if (tag == 'B')
+        birth = counts;
+      else
+        survival = counts;
+    } else if (tag == 'C' || tag == 'G' || (part == 2 && isdigit(*at))) {
+      char *last;
+      long count = strtol(at + (isdigit(*at) ? 0 : 1), &last, 10);
+      if (count < 2 || count > RU_STATES || (seen & 4))
+        break;
+      seen |= 4;
+      states = (int)count;
+      end = last;
+    } else if (part < 2 && (isdigit(*at) || *at == '/')) {
+      // Letterless rules give the survival counts first
+      int counts = _counts(at, &end);
+      if (counts < 0 || (seen & (part == 0 ? 2 : 1)))
+        break;
+      seen |= part == 0 ? 2 : 1;
+      if (part == 0)
+        survival = counts;
+      else
+        birth = counts;
+    } else {
+      break;
+    }
+    at = end;
+    part++;
+    if (*at == '/')
+      at++;
+    else if (*at != '\0')
+      break;
+  }
+  if (*at != '\0' || part < 2) {
+    printf("RU_parse: %s is not a rule\n", text);
+    return -1;
+  }
+  RU_make(rule, (uint16_t)birth, (uint16_t)survival, states);
+  return 0;
+}
+
+/**
+ * Writes a rule in the B/S notation, with the number of states of a
+ * Generations rule as a third part
+ * @param rule Pointer to the rule
+ * @param text Receives the rule string
+ * @param size Number of bytes of text, RU_NAME is always enough
+ */
+void RU_format(const Rule *rule, char *text, size_t size) {
+  char name[RU_NAME];
+  int length = 0;
+
+  name[length++] = 'B';
+  for (int n = 0; n <= 8; n++)
+    if ((rule->birth >> n) & 1)
+      name[length++] = (char)('0' + n);
+  name[length++] = '/';
+  name[length++] = 'S';
+  for (int n = 0; n <= 8; n++)
+    if ((rule->survival >> n) & 1)
+      name[length++] = (char)('0' + n);
+  name[length] = '\0';
+  if (rule->states > 2)
+    snprintf(name + length, sizeof(name) - length, "/C%d", rule->states);
+  snprintf(text, size, "%s", name);
+}
+
+/**
+ * Checks if the rule is the B3/S23 rule of the Game of Life
+ * @param rule Pointer to the rule
+ * @return 1 If it is. Otherwise return 0.
+ */
+int RU_is_life(const Rule *rule) {
+  return rule->states == 2 && rule->bits == RU_LIFE_BITS;
+}
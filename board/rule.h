@@ -0,0 +1,43 @@
+/**
+ * @file rule.h
+ * @brief Header file for the rules of life-like and Generations automata,
+ * written as B/S strings and compiled into transition tables
+ */
+#ifndef RULE_H
+#define RULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Largest number of states of a Generations rule */
+#define RU_STATES (256)
+
+/** Longest rule string written by RU_format, with its terminating zero */
+#define RU_NAME (40)
+
+/** Packed form of B3/S23, see Rule */
+#define RU_LIFE_BITS ((1u << 3) | (1u << 19) | (1u << 20))
+
+/** Rule of a life-like automaton, or of a Generations one when it has more
+ * than two states. State 0 is dead and state 1 alive; an alive cell that does
+ * not survive goes through the dying states 2 to states - 1 before being
+ * dead again. Only alive cells count as neighbours. */
+typedef struct {
+  uint16_t birth;    /**< Bit n set: a dead cell with n alive neighbours is
+                        born */
+  uint16_t survival; /**< Bit n set: an alive cell with n alive neighbours
+                        stays alive */
+  int states;        /**< Number of states, 2 for the life-like rules */
+  uint32_t bits;     /**< Truth table of the two state rules over 64 cells:
+                        bit 16 * alive + population is set when the cell is
+                        alive in the next generation, population counting
+                        the 3x3 block with the cell itself */
+  unsigned char next[RU_STATES][10]; /**< State following the given one with
+                                        the given 3x3 alive population */
+} Rule;
+
+Rule *RU_make(Rule *rule, uint16_t birth, uint16_t survival, int states);
+int RU_parse(Rule *rule, const char *text);
+void RU_format(const Rule *rule, char *text, size_t size);
+int RU_is_life(const Rule *rule);
+#endif
@@ -0,0 +1,233 @@
+/**
+ * @file simd.c
+ * @brief Contains the scalar, SSE2 and AVX2 inner loops of the packed kernel
+ * and picks the widest one the CPU supports at runtime
+ */
+#include <packed.h>
+#include <simd.h>
+#include <stddef.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PB_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Horizontal sums of a single interior word
+ * @param row Packed row
+ * @param h0 Receives the low bits of the sums
+ * @param h1 Receives the high bits of the sums
+ * @param k Index of the word, 0 < k < words - 1
+ */
+static inline void _horizontal_word(const uint64_t *row, uint64_t *h0,
+                                    uint64_t *h1, int k) {
+  uint64_t c = row[k];
+  PB_horizontal((c << 1) | (row[k - 1] >> 63), c, (c >> 1) | (row[k + 1] << 63),
+                &h0[k], &h1[k]);
+}
+
+/**
+ * Adds three rows of horizontal sums for a single word and applies the rule
+ * @param h0 Low bits of the sums of the rows above, at and below
+ * @param h1 High bits of the sums of the rows above, at and below
+ * @param row Current generation of the row
+ * @param out Receives the next generation of the row
+ * @param k Index of the word
+ */
+static inline void _combine_word(uint64_t *const h0[3], uint64_t *const h1[3],
+                                 const uint64_t *row, uint64_t *out, int k) {
+  out[k] = PB_life(h0[0][k], h1[0][k], h0[1][k], h1[1][k], h0[2][k], h1[2][k],
+                   row[k]);
+}
+
+/** Scalar horizontal sums of words [begin, end), see PB_Kernels */
+static void _horizontal_scalar(const uint64_t *row, uint64_t *h0,
+                               uint64_t *h1, int begin, int end) {
+  for (int k = begin; k < end; k++)
+    _horizontal_word(row, h0, h1, k);
+}
+
+/** Scalar rule application to words [0, words), see PB_Kernels */
+static void _combine_scalar(uint64_t *const h0[3], uint64_t *const h1[3],
+                            const uint64_t *row, uint64_t *out, int words) {
+  for (int k = 0; k < words; k++)
+    _combine_word(h0, h1, row, out, k);
+}
+
+#ifdef PB_X86
+/** SSE2 horizontal sums, two words per instruction */
+__attribute__((target("sse2"))) static void
+_horizontal_sse2(const uint64_t *row, uint64_t *h0, uint64_t *h1, int begin,
+                 int end) {
+  int k = begin;
+  for (; k + 2 <= end; k += 2) {
+    __m128i c = _mm_loadu_si128((const __m128i *)(row + k));
+    __m128i prev = _mm_loadu_si128((const __m128i *)(row + k - 1));
+    __m128i next = _mm_loadu_si128((const __m128i *)(row + k + 1));
+    __m128i w = _mm_or_si128(_mm_slli_epi64(c, 1), _mm_srli_epi64(prev, 63));
+    __m128i e = _mm_or_si128(_mm_srli_epi64(c, 1), _mm_slli_epi64(next, 63));
+    __m128i wc = _mm_xor_si128(w, c);
+    _mm_storeu_si128((__m128i *)(h0 + k), _mm_xor_si128(wc, e));
+    _mm_storeu_si128((__m128i *)(h1 + k),
+                     _mm_or_si128(_mm_and_si128(w, c), _mm_and_si128(e, wc)));
+  }
+  for (; k < end; k++)
+    _horizontal_word(row, h0, h1, k);
+}
+
+/** SSE2 rule application, two words (128 cells) per instruction */
+__attribute__((target("sse2"))) static void
+_combine_sse2(uint64_t *const h0[3], uint64_t *const h1[3],
+              const uint64_t *row, uint64_t *out, int words) {
+  int k = 0;
+  for (; k + 2 <= words; k += 2) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(h0[0] + k));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(h1[0] + k));
+    __m128i b0 = _mm_loadu_si128((const __m128i *)(h0[1] + k));
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(h1[1] + k));
+    __m128i c0 = _mm_loadu_si128((const __m128i *)(h0[2] + k));
+    __m128i c1 = _mm_loadu_si128((const __m128i *)(h1[2] + k));
+    __m128i alive = _mm_loadu_si128((const __m128i *)(row + k));
+
+    __m128i ab = _mm_xor_si128(a0, b0);
+    __m128i x = _mm_xor_si128(ab, c0);
+    __m128i carry = _mm_or_si128(_mm_and_si128(a0, b0), _mm_and_si128(c0, ab));
+    __m128i p = _mm_xor_si128(a1, b1), q = _mm_and_si128(a1, b1);
+    __m128i r = _mm_xor_si128(c1, carry), u = _mm_and_si128(c1, carry);
+    __m128i twos_is_one =
+        _mm_andnot_si128(_mm_or_si128(q, u), _mm_xor_si128(p, r));
+    __m128i twos_is_two =
+        _mm_or_si128(_mm_and_si128(p, r), _mm_andnot_si128(_mm_or_si128(p, r),
+                                                           _mm_xor_si128(q, u)));
+    __m128i next = _mm_or_si128(
+        _mm_and_si128(x, twos_is_one),
+        _mm_andnot_si128(x, _mm_and_si128(twos_is_two, alive)));
+    _mm_storeu_si128((__m128i *)(out + k), next);
+  }
+  for (; k < words; k++)
+    _combine_word(h0, h1, row, out, k);
+}
+
+/** AVX2 horizontal sums, four words per instruction */
+__attribute__((target("avx2"))) static void
+_horizontal_avx2(const uint64_t *row, uint64_t *h0, uint64_t *h1, int begin,
+                 int end) {
+  int k = begin;
+  for (; k + 4 <= end; k += 4) {
+    __m256i c = _mm256_loadu_si256((const __m256i *)(row + k));
+    __m256i prev = _mm256_loadu_si256((const __m256i *)(row + k - 1));
+    __m256i next = _mm256_loadu_si256((const __m256i *)(row + k + 1));
+    __m256i w =
+        _mm256_or_si256(_mm256_slli_epi64(c, 1), _mm256_srli_epi64(prev, 63));
+    __m256i e =
+        _mm256_or_si256(_mm256_srli_epi64(c, 1), _mm256_slli_epi64(next, 63));
+    __m256i wc = _mm256_xor_si256(w, c);
+    _mm256_storeu_si256((__m256i *)(h0 + k), _mm256_xor_si256(wc, e));
+    _mm256_storeu_si256(
+        (__m256i *)(h1 + k),
+        _mm256_or_si256(_mm256_and_si256(w, c), _mm256_and_si256(e, wc)));
+  }
+  for (; k < end; k++)
+    _horizontal_word(row, h0, h1, k);
+}
+
+/** AVX2 rule application, four words (256 cells) per instruction */
+__attribute__((target("avx2"))) static void
+_combine_avx2(uint64_t *const h0[3], uint64_t *const h1[3],
+              const uint64_t *row, uint64_t *out, int words) {
+  int k = 0;
+  for (; k + 4 <= words; k += 4) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i *)(h0[0] + k));
+    __m256i a1 = _mm256_loadu_si256((const __m256i *)(h1[0] + k));
+    __m256i b0 = _mm256_loadu_si256((const __m256i *)(h0[1] + k));
+    __m256i b1 = _mm256_loadu_si256((const __m256i *)(h1[1] + k));
+    __m256i c0 = _mm256_loadu_si256((const __m256i *)(h0[2] + k));
+    __m256i c1 = _mm256_loadu_si256((const __m256i *)(h1[2] + k));
+    __m256i alive = _mm256_loadu_si256((const __m256i *)(row + k));
+
+    __m256i ab = _mm256_xor_si256(a0, b0);
+    __m256i x = _mm256_xor_si256(ab, c0);
+    __m256i carry =
+        _mm256_or_si256(_mm256_and_si256(a0, b0), _mm256_and_si256(c0, ab));
+    __m256i p = _mm256_xor_si256(a1, b1), q = _mm256_and_si256(a1, b1);
+    __m256i r = _mm256_xor_si256(c1, carry), u = _mm256_and_si256(c1, carry);
+    __m256i twos_is_one =
+        _mm256_andnot_si256(_mm256_or_si256(q, u), _mm256_xor_si256(p, r));
+    __m256i twos_is_two = _mm256_or_si256(
+        _mm256_and_si256(p, r),
+        _mm256_andnot_si256(_mm256_or_si256(p, r), _mm256_xor_si256(q, u)));
+    __m256i next = _mm256_or_si256(
+        _mm256_and_si256(x, twos_is_one),
+        _mm256_andnot_si256(x, _mm256_and_si256(twos_is_two, alive)));
+    _mm256_storeu_si256((__m256i *)(out + k), next);
+  }
+  for (; k < words; k++)
+    _combine_word(h0, h1, row, out, k);
+}
+#endif
+
+/** Every set of inner loops, from the widest to the narrowest */
+static const PB_Kernels kernels[] = {
+#ifdef PB_X86
+    {"avx2", _horizontal_avx2, _combine_avx2},
+    {"sse2", _horizontal_sse2, _combine_sse2},
+#endif
+    {"scalar", _horizontal_scalar, _combine_scalar},
+};
+
+/** Number of entries in kernels */
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+/** Kernels in use, NULL until the first call of PB_kernels */
+static const PB_Kernels *selected = NULL;
+
+/**
+ * Checks if the CPU running the program supports the given kernels
+ * @param k Pointer to the set of kernels
+ * @return 1 if supported. Otherwise return 0.
+ */
+static int _supported(const PB_Kernels *k) {
+#ifdef PB_X86
+  if (strcmp(k->name, "avx2") == 0)
+    return __builtin_cpu_supports("avx2");
+  if (strcmp(k->name, "sse2") == 0)
+    return __builtin_cpu_supports("sse2");
+#endif
+  return 1;
+}
+
+/**
+ * Returns the kernels used by PB_step, choosing the widest supported ones on
+ * the first call
+ * @return Pointer to the set of kernels
+ */
+const PB_Kernels *PB_kernels(void) {
+  if (selected == NULL) {
+    for (int i = 0; i < KERNEL_COUNT && selected == NULL; i++)
+      if (_supported(&kernels[i]))
+        selected = &kernels[i];
+  }
+  return selected;
+}
+
+/**
+ * Forces the kernels used by PB_step, e.g. to compare them with each other
+ * @param name Name of the instruction set: "avx2", "sse2" or "scalar"
+ * @return 1 if the kernels exist and the CPU supports them. Otherwise return 0.
+ */
+int PB_select_kernel(const char *name) {
+  for (int i = 0; i < KERNEL_COUNT; i++) {
+    if (strcmp(kernels[i].name, name) == 0 && _supported(&kernels[i])) {
+      selected = &kernels[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Returns the name of the kernels used by PB_step
+ * @return Name of the instruction set
+ */
+const char *PB_kernel_name(void) { return PB_kernels()->name; }
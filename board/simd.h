@@ -0,0 +1,28 @@
+/**
+ * @file simd.h
+ * @brief Header file for the vectorized inner loops of the packed kernel and
+ * their runtime selection according to the features of the CPU
+ */
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/** Set of inner loops used by PB_step. The edge words of every row are
+ * handled by scalar code in packed.c, these only run over the interior. */
+typedef struct {
+  const char *name; /**< Name of the instruction set, e.g. "avx2" */
+  /** Horizontal sums of words [begin, end) of a row, 0 < begin and end <
+   * words so that both neighbouring words can be read */
+  void (*horizontal)(const uint64_t *row, uint64_t *h0, uint64_t *h1,
+                     int begin, int end);
+  /** Adds three rows of horizontal sums and applies the rule to words
+   * [0, words) of one row */
+  void (*combine)(uint64_t *const h0[3], uint64_t *const h1[3],
+                  const uint64_t *row, uint64_t *out, int words);
+} PB_Kernels;
+
+const PB_Kernels *PB_kernels(void);
+int PB_select_kernel(const char *name);
+const char *PB_kernel_name(void);
+#endif
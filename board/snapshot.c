@@ -0,0 +1,311 @@
+/**
+ * @file snapshot.c
+ * @brief Contains the reading and writing of snapshot files. Files are
+ * written next to their final path and renamed once complete, so a run
+ * killed while checkpointing keeps its previous snapshot.
+ */
+#include <fcntl.h>
+#include <snapshot.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Initial value of the checksum */
+#define SN_SEED (0xCBF29CE484222325ull)
+
+/**
+ * Adds words to the checksum
+ * @param hash Checksum of the previous words
+ * @param words The words
+ * @param count Number of words
+ * @return Checksum including the words
+ */
+static uint64_t _checksum(uint64_t hash, const uint64_t *words, size_t count) {
+  for (size_t k = 0; k < count; k++) {
+    hash = (hash ^ words[k]) * 0x100000001B3ull;
+    hash ^= hash >> 32;
+  }
+  return hash;
+}
+
+/**
+ * Fills the header of a board
+ * @param header Pointer to the header
+ * @param height Height of the board
+ * @param width Width of the board
+ * @param version Version of the board
+ * @param generation Number of the generation saved
+ */
+static void _header(SN_Header *header, int height, int width, Version version,
+                    uint64_t generation) {
+  memset(header, 0, sizeof(SN_Header));
+  memcpy(header->magic, SN_MAGIC, sizeof(SN_MAGIC));
+  header->format = SN_FORMAT;
+  header->height = height;
+  header->width = width;
+  header->version = (uint32_t)version;
+  header->words = (uint32_t)((width + PB_WORD_BITS - 1) / PB_WORD_BITS);
+  header->generation = generation;
+}
+
+/**
+ * Opens the temporary file written before it replaces the given path
+ * @param path Path of the snapshot
+ * @param temporary Receives the path of the temporary file
+ * @param size Number of bytes of temporary
+ * @return The open file, NULL if it could not be created
+ */
+static FILE *_create(const char *path, char *temporary, size_t size) {
+  snprintf(temporary, size, "%s.tmp", path);
+  FILE *file = fopen(temporary, "wb");
+  if (file == NULL)
+    printf("SN_save: Could not create %s\n", temporary);
+  return file;
+}
+
+/**
+ * Writes the final header, closes the temporary file and moves it to the
+ * path of the snapshot
+ * @param file The temporary file, its cells written
+ * @param header The header, with the checksum of the cells
+ * @param temporary Path of the temporary file
+ * @param path Path of the snapshot
+ * @return 0 on success, -1 otherwise
+ */
+static int _finish(FILE *file, SN_Header *header, const char *temporary,
+                   const char *path) {
+  int failed = fseek(file, 0, SEEK_SET) != 0 ||
+               fwrite(header, sizeof(SN_Header), 1, file) != 1 ||
+               fflush(file) != 0 || fsync(fileno(file)) != 0;
+  failed |= fclose(file) != 0;
+  if (failed || rename(temporary, path) != 0) {
+    printf("SN_save: Could not write %s\n", path);
+    remove(temporary);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Starts writing a snapshot whose rows are then given in order by
+ * SN_write_rows, so a board that is not in memory as a whole can be saved
+ * @param path Path of the snapshot, replaced once SN_end succeeds
+ * @param height Height of the board
+ * @param width Width of the board
+ * @param version Version of the board
+ * @param generation Number of the generation, stored in the header
+ * @return Pointer to the writer, NULL if the file could not be created
+ */
+SN_Writer *SN_begin(const char *path, int height, int width, Version version,
+                    uint64_t generation) {
+  SN_Writer *writer = (SN_Writer *)malloc(sizeof(SN_Writer));
+  if (writer == NULL) {
+    printf("SN_begin: Could not allocate the writer\nExiting...\n");
+    exit(1);
+  }
+  _header(&writer->header, height, width, version, generation);
+  snprintf(writer->path, sizeof(writer->path), "%s", path);
+  writer->hash = SN_SEED;
+  writer->rows = 0;
+  writer->file = _create(path, writer->temporary, sizeof(writer->temporary));
+  writer->failed = writer->file == NULL ||
+                   fwrite(&writer->header, sizeof(SN_Header), 1,
+                          writer->file) != 1;
+  if (writer->file == NULL) {
+    free(writer);
+    return NULL;
+  }
+  return writer;
+}
+
+/**
+ * Writes the next rows of a snapshot
+ * @param writer Pointer to the writer
+ * @param rows The rows, words words each laid out like those of a
+ * PackedBoard
+ * @param count Number of rows
+ * @return 0 on success, -1 otherwise
+ */
+int SN_write_rows(SN_Writer *writer, const uint64_t *rows, int count) {
+  size_t words = (size_t)count * writer->header.words;
+  if (writer->failed || writer->rows + count > writer->header.height)
+    return -1;
+  writer->hash = _checksum(writer->hash, rows, words);
+  writer->failed = fwrite(rows, sizeof(uint64_t), words, writer->file) != words;
+  writer->rows += count;
+  return writer->failed ? -1 : 0;
+}
+
+/**
+ * Completes a snapshot and frees the writer. The file only replaces the one
+ * at its path if every row was written.
+ * @param writer Pointer to the writer
+ * @param checksum 1 to store a checksum of the cells
+ * @return 0 on success, -1 otherwise
+ */
+int SN_end(SN_Writer *writer, int checksum) {
+  int result = -1;
+  if (writer->failed || writer->rows != writer->header.height) {
+    printf("SN_save: Could not write %s\n", writer->path);
+    fclose(writer->file);
+    remove(writer->temporary);
+  } else {
+    writer->header.flags = checksum ? SN_CHECKSUM : 0;
+    writer->header.checksum = checksum ? writer->hash : 0;
+    result = _finish(writer->file, &writer->header, writer->temporary,
+                     writer->path);
+  }
+  free(writer);
+  return result;
+}
+
+/**
+ * Saves the current generation of a board
+ * @param path Path of the snapshot, replaced if it exists
+ * @param board Pointer to the struct Board
+ * @param generation Number of the generation, stored in the header
+ * @param checksum 1 to store a checksum of the cells
+ * @return 0 on success, -1 otherwise
+ */
+int SN_save(const char *path, Board *board, uint64_t generation,
+            int checksum) {
+  SN_Writer *writer =
+      SN_begin(path, board->height, board->width, board->version, generation);
+  if (writer == NULL)
+    return -1;
+  uint64_t *row = (uint64_t *)malloc(writer->header.words * sizeof(uint64_t));
+  if (row == NULL) {
+    printf("SN_save: Could not allocate a row\nExiting...\n");
+    exit(1);
+  }
+
+  for (int i = 0; i < board->height; i++) {
+    memset(row, 0, writer->header.words * sizeof(uint64_t));
+    for (int j = 0; j < board->width; j++)
+      if (B_is_alive(board->cell[i][j]))
+        row[j / PB_WORD_BITS] |= (uint64_t)1 << (j % PB_WORD_BITS);
+    if (SN_write_rows(writer, row, 1) != 0)
+      break;
+  }
+  free(row);
+  return SN_end(writer, checksum);
+}
+
+/**
+ * Saves the current generation of a packed board, writing its rows as they
+ * are
+ * @param path Path of the snapshot, replaced if it exists
+ * @param packed Pointer to the packed board
+ * @param generation Number of the generation, stored in the header
+ * @param checksum 1 to store a checksum of the cells
+ * @return 0 on success, -1 otherwise
+ */
+int SN_save_packed(const char *path, PackedBoard *packed, uint64_t generation,
+                   int checksum) {
+  char temporary[4096];
+  SN_Header header;
+  size_t count = (size_t)packed->height * packed->words;
+  _header(&header, packed->height, packed->width, packed->version, generation);
+  header.flags = checksum ? SN_CHECKSUM : 0;
+  header.checksum = checksum ? _checksum(SN_SEED, packed->bits, count) : 0;
+
+  FILE *file = _create(path, temporary, sizeof(temporary));
+  if (file == NULL)
+    return -1;
+  if (fwrite(&header, sizeof(SN_Header), 1, file) != 1 ||
+      fwrite(packed->bits, sizeof(uint64_t), count, file) != count) {
+    printf("SN_save_packed: Could not write %s\n", path);
+    fclose(file);
+    remove(temporary);
+    return -1;
+  }
+  return _finish(file, &header, temporary, path);
+}
+
+/**
+ * Loads a snapshot into a packed board without copying its cells: the file
+ * is mapped privately and stays one of the two generations of the board, so
+ * only the back buffer is allocated
+ * @param path Path of the snapshot
+ * @param generation Receives the number of the generation saved, may be NULL
+ * @return Pointer to the packed board, NULL if the file is not a valid
+ * snapshot
+ */
+PackedBoard *SN_load_packed(const char *path, uint64_t *generation) {
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SN_Header)) {
+    printf("SN_load: Could not read %s\n", path);
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  // Private and writable, so cells set before the first step stay in memory
+  void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    printf("SN_load: Could not map %s\n", path);
+    return NULL;
+  }
+
+  SN_Header *header = (SN_Header *)mapping;
+  uint64_t *bits = (uint64_t *)(header + 1);
+  const char *error = NULL;
+  if (memcmp(header->magic, SN_MAGIC, sizeof(SN_MAGIC)) != 0)
+    error = "not a snapshot";
+  else if (header->format > SN_FORMAT)
+    error = "written by a newer format";
+  else if (header->height < 1 || header->width < 1 ||
+           header->version > UNBOUNDED ||
+           header->words != (uint32_t)((header->width + PB_WORD_BITS - 1) /
+                                       PB_WORD_BITS))
+    error = "bad header";
+  else if ((size_t)st.st_size != sizeof(SN_Header) + (size_t)header->height *
+                                                         header->words *
+                                                         sizeof(uint64_t))
+    error = "truncated";
+  else if ((header->flags & SN_CHECKSUM) &&
+           _checksum(SN_SEED, bits, (size_t)header->height * header->words) !=
+               header->checksum)
+    error = "bad checksum";
+  // Bits past the last column have to be zero for the kernels
+  for (int i = 0; error == NULL && header->width % PB_WORD_BITS != 0 &&
+                  i < header->height;
+       i++)
+    if (bits[(size_t)(i + 1) * header->words - 1] >>
+        (header->width % PB_WORD_BITS))
+      error = "cells past the last column";
+  if (error != NULL) {
+    printf("SN_load: %s: %s\n", path, error);
+    munmap(mapping, (size_t)st.st_size);
+    return NULL;
+  }
+
+  PackedBoard *packed = PB_map(header->height, header->width,
+                               (Version)header->version, bits, mapping,
+                               (size_t)st.st_size);
+  if (generation != NULL)
+    *generation = header->generation;
+  return packed;
+}
+
+/**
+ * Loads a snapshot into a new board
+ * @param path Path of the snapshot
+ * @param generation Receives the number of the generation saved, may be NULL
+ * @return Pointer to the struct Board, NULL if the file is not a valid
+ * snapshot
+ */
+Board *SN_load(const char *path, uint64_t *generation) {
+  PackedBoard *packed = SN_load_packed(path, generation);
+  if (packed == NULL)
+    return NULL;
+  Board *board = PB_to_board(
+      packed, B_new(packed->height, packed->width, packed->version));
+  PB_destroy(packed);
+  return board;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file snapshot.h
+ * @brief Header file for the binary snapshot files of boards, used to
+ * checkpoint long runs and resume them
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <board.h>
+#include <packed.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** First bytes of every snapshot file */
+#define SN_MAGIC "GOLSNAP"
+
+/** Version of the format written */
+#define SN_FORMAT (1)
+
+/** Flag of the header telling the checksum field is set */
+#define SN_CHECKSUM (1u)
+
+/** Header of a snapshot file, in the byte order of the machine. It is
+ * followed by height rows of words 64-bit words laid out like the rows of a
+ * PackedBoard, so the cells can be read in place from a mapped file. */
+typedef struct {
+  char magic[8];       /**< SN_MAGIC and a null byte */
+  uint32_t format;     /**< SN_FORMAT of the writer */
+  uint32_t flags;      /**< SN_CHECKSUM or 0 */
+  int32_t height;      /**< Height of the board */
+  int32_t width;       /**< Width of the board */
+  uint32_t version;    /**< Version of the board */
+  uint32_t words;      /**< Number of 64-bit words per row */
+  uint64_t generation; /**< Number of the generation saved */
+  uint64_t checksum;   /**< Hash of the words of the cells */
+  uint8_t reserved[16]; /**< Zero, pads the header to 64 bytes */
+} SN_Header;
+
+/** Snapshot being written row by row, see SN_begin */
+typedef struct {
+  FILE *file;           /**< Temporary file being written */
+  SN_Header header;     /**< Header, completed by SN_end */
+  uint64_t hash;        /**< Checksum of the rows written so far */
+  int rows;             /**< Number of rows written so far */
+  int failed;           /**< Set once a write failed */
+  char path[4096];      /**< Path of the snapshot */
+  char temporary[4096]; /**< Path of the temporary file */
+} SN_Writer;
+
+int SN_save(const char *path, Board *board, uint64_t generation,
+            int checksum);
+int SN_save_packed(const char *path, PackedBoard *packed, uint64_t generation,
+                   int checksum);
+SN_Writer *SN_begin(const char *path, int height, int width, Version version,
+                    uint64_t generation);
+int SN_write_rows(SN_Writer *writer, const uint64_t *rows, int count);
+int SN_end(SN_Writer *writer, int checksum);
+PackedBoard *SN_load_packed(const char *path, uint64_t *generation);
+Board *SN_load(const char *path, uint64_t *generation);
+#endif
@@ -0,0 +1,420 @@
+/**
+ * @file sparse.c
+ * @brief Contains the unbounded sparse board. Live areas of the plane are
+ * stored as 64x64 chunks of packed cells in a hash map; memory follows the
+ * current population rather than the extent of the pattern or its peak.
+ */
+#include <packed.h>
+#include <sparse.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Number of slots of a new chunk map */
+#define SB_MIN_CAPACITY (64)
+
+/**
+ * Returns the chunk coordinate holding the given cell coordinate, rounding
+ * towards negative infinity
+ * @param x Row or column of a cell
+ * @return Row or column of the chunk
+ */
+static int64_t _chunk_of(int64_t x) {
+  return (x - (x & (SB_CHUNK - 1))) / SB_CHUNK;
+}
+
+/**
+ * Hash of chunk coordinates
+ * @param row Chunk row
+ * @param col Chunk column
+ * @return Hash value
+ */
+static size_t _hash(int64_t row, int64_t col) {
+  uint64_t h = (uint64_t)row * 0x9E3779B97F4A7C15ULL;
+  h ^= (uint64_t)col * 0xC2B2AE3D27D4EB4FULL;
+  return (size_t)(h ^ (h >> 31));
+}
+
+/**
+ * Allocates the slots of a chunk map
+ * @param map Pointer to the map
+ * @param capacity Number of slots, a power of two
+ */
+static void _map_init(SB_Map *map, size_t capacity) {
+  map->entries = (SB_Entry *)calloc(capacity, sizeof(SB_Entry));
+  if (map->entries == NULL) {
+    printf("SparseBoard: Could not allocate the chunk map\nExiting...\n");
+    exit(1);
+  }
+  map->capacity = capacity;
+  map->count = 0;
+}
+
+/**
+ * Looks up the slot of the given chunk coordinates
+ * @param map Pointer to the map
+ * @param row Chunk row
+ * @param col Chunk column
+ * @return The slot holding the chunk, or the empty slot where it belongs
+ */
+static SB_Entry *_map_slot(SB_Map *map, int64_t row, int64_t col) {
+  size_t mask = map->capacity - 1;
+  for (size_t h = _hash(row, col) & mask;; h = (h + 1) & mask) {
+    SB_Entry *entry = &map->entries[h];
+    if (entry->chunk == NULL || (entry->row == row && entry->col == col))
+      return entry;
+  }
+}
+
+/**
+ * Returns the chunk at the given chunk coordinates
+ * @param map Pointer to the map
+ * @param row Chunk row
+ * @param col Chunk column
+ * @return Pointer to the chunk, NULL if it is not in the map
+ */
+static SB_Chunk *_map_get(SB_Map *map, int64_t row, int64_t col) {
+  return _map_slot(map, row, col)->chunk;
+}
+
+/**
+ * Adds a chunk that is not in the map yet, growing it to stay at most half
+ * full
+ * @param map Pointer to the map
+ * @param row Chunk row
+ * @param col Chunk column
+ * @param chunk Pointer to the chunk
+ */
+static void _map_put(SB_Map *map, int64_t row, int64_t col, SB_Chunk *chunk) {
+  if (2 * (map->count + 1) > map->capacity) {
+    SB_Map grown;
+    _map_init(&grown, map->capacity * 2);
+    for (size_t k = 0; k < map->capacity; k++) {
+      SB_Entry *entry = &map->entries[k];
+      if (entry->chunk != NULL)
+        *_map_slot(&grown, entry->row, entry->col) = *entry;
+    }
+    grown.count = map->count;
+    free(map->entries);
+    *map = grown;
+  }
+  SB_Entry *entry = _map_slot(map, row, col);
+  entry->row = row;
+  entry->col = col;
+  entry->chunk = chunk;
+  map->count++;
+}
+
+/**
+ * Takes a chunk from the free list, allocating one when it is empty
+ * @param sparse Pointer to the sparse board
+ * @return Pointer to a chunk with undefined cells
+ */
+static SB_Chunk *_chunk_alloc(SparseBoard *sparse) {
+  SB_Chunk *chunk = sparse->free;
+  if (chunk != NULL) {
+    sparse->free = chunk->next;
+    sparse->spare--;
+    return chunk;
+  }
+  chunk = (SB_Chunk *)malloc(sizeof(SB_Chunk));
+  if (chunk == NULL) {
+    printf("SparseBoard: Could not allocate a chunk\nExiting...\n");
+    exit(1);
+  }
+  return chunk;
+}
+
+/**
+ * Gives a chunk back to the free list, or to the system when the list already
+ * holds SB_FREE_CHUNKS of them
+ * @param sparse Pointer to the sparse board
+ * @param chunk Pointer to the chunk
+ */
+static void _chunk_free(SparseBoard *sparse, SB_Chunk *chunk) {
+  if (sparse->spare >= SB_FREE_CHUNKS) {
+    free(chunk);
+    return;
+  }
+  chunk->next = sparse->free;
+  sparse->free = chunk;
+  sparse->spare++;
+}
+
+/**
+ * Empties a chunk map, giving it the number of slots that keeps the given
+ * number of chunks at most a quarter full. A map much bigger than that, left
+ * by a larger population, is allocated again at the smaller size.
+ * @param map Pointer to the map
+ * @param count Number of chunks expected
+ */
+static void _map_clear(SB_Map *map, size_t count) {
+  size_t capacity = SB_MIN_CAPACITY;
+  while (capacity < 4 * count)
+    capacity *= 2;
+  if (map->capacity > 2 * capacity) {
+    free(map->entries);
+    _map_init(map, capacity);
+    return;
+  }
+  memset(map->entries, 0, map->capacity * sizeof(SB_Entry));
+  map->count = 0;
+}
+
+/**
+ * Creates new empty sparse board
+ * @return Pointer to the sparse board
+ */
+SparseBoard *SB_new(void) {
+  SparseBoard *sparse = (SparseBoard *)malloc(sizeof(SparseBoard));
+  if (sparse == NULL) {
+    printf("SB_new: Could not allocate the board\nExiting...\n");
+    exit(1);
+  }
+  _map_init(&sparse->map, SB_MIN_CAPACITY);
+  _map_init(&sparse->next, SB_MIN_CAPACITY);
+  sparse->free = NULL;
+  sparse->spare = 0;
+  sparse->generation = 0;
+  return sparse;
+}
+
+/**
+ * Creates a sparse board holding the current generation of the board
+ * @param board Pointer to struct board
+ * @param row Row of the plane receiving the first row of the board
+ * @param col Column of the plane receiving the first column of the board
+ * @return Pointer to the sparse board
+ */
+SparseBoard *SB_from_board(Board *board, int64_t row, int64_t col) {
+  SparseBoard *sparse = SB_new();
+  for (int i = 0; i < board->height; i++)
+    for (int j = 0; j < board->width; j++)
+      if (B_is_alive(board->cell[i][j]))
+        SB_set_alive(sparse, row + i, col + j);
+  return sparse;
+}
+
+/**
+ * Writes the window of the plane starting at the given coordinates into the
+ * board
+ * @param sparse Pointer to the sparse board
+ * @param board Pointer to struct board receiving the window
+ * @param row Row of the plane shown on the first row of the board
+ * @param col Column of the plane shown on the first column of the board
+ * @return Pointer to struct board
+ */
+Board *SB_to_board(SparseBoard *sparse, Board *board, int64_t row,
+                   int64_t col) {
+  B_reset(board);
+  for (size_t k = 0; k < sparse->map.capacity; k++) {
+    SB_Entry *entry = &sparse->map.entries[k];
+    if (entry->chunk == NULL)
+      continue;
+    int64_t top = entry->row * SB_CHUNK - row;
+    int64_t left = entry->col * SB_CHUNK - col;
+    if (top >= board->height || left >= board->width || top + SB_CHUNK <= 0 ||
+        left + SB_CHUNK <= 0)
+      continue;
+    for (int i = 0; i < SB_CHUNK; i++) {
+      uint64_t bits = entry->chunk->bits[i];
+      if (top + i < 0 || top + i >= board->height)
+        continue;
+      for (; bits != 0; bits &= bits - 1) {
+        int64_t j = left + __builtin_ctzll(bits);
+        if (j >= 0 && j < board->width)
+          board->cell[top + i][j] = ALIVE;
+      }
+    }
+  }
+  board->dirty = 1;
+  return board;
+}
+
+/**
+ * Checks if a chunk has alive cells on the border facing the given neighbour
+ * @param chunk Pointer to the chunk
+ * @param dr Row direction of the neighbour, -1, 0 or 1
+ * @param dc Column direction of the neighbour, -1, 0 or 1
+ * @return 1 if the neighbour can get alive cells from this chunk
+ */
+static int _reaches(SB_Chunk *chunk, int dr, int dc) {
+  uint64_t mask = dc < 0 ? 1 : dc > 0 ? (uint64_t)1 << 63 : ~(uint64_t)0;
+  int first = dr > 0 ? SB_CHUNK - 1 : 0;
+  int last = dr < 0 ? 0 : SB_CHUNK - 1;
+  for (int i = first; i <= last; i++)
+    if (chunk->bits[i] & mask)
+      return 1;
+  return 0;
+}
+
+/**
+ * Computes the next generation of the chunk at the given coordinates from it
+ * and its eight neighbours
+ * @param sparse Pointer to the sparse board
+ * @param row Chunk row
+ * @param col Chunk column
+ * @param out Receives the cells of the next generation
+ * @return 1 if any cell of the next generation is alive
+ */
+static int _next_chunk(SparseBoard *sparse, int64_t row, int64_t col,
+                       SB_Chunk *out) {
+  SB_Chunk *n[3][3];
+  uint64_t h0[SB_CHUNK + 2], h1[SB_CHUNK + 2];
+  uint64_t any = 0;
+
+  for (int dr = -1; dr <= 1; dr++)
+    for (int dc = -1; dc <= 1; dc++)
+      n[dr + 1][dc + 1] = _map_get(&sparse->map, row + dr, col + dc);
+
+  // Horizontal sums of the 64 rows and of the rows just above and below
+  for (int r = -1; r <= SB_CHUNK; r++) {
+    int y = r < 0 ? 0 : r < SB_CHUNK ? 1 : 2;
+    int i = r & (SB_CHUNK - 1);
+    uint64_t c = n[y][1] != NULL ? n[y][1]->bits[i] : 0;
+    uint64_t w = n[y][0] != NULL ? n[y][0]->bits[i] >> 63 : 0;
+    uint64_t e = n[y][2] != NULL ? n[y][2]->bits[i] << 63 : 0;
+    PB_horizontal((c << 1) | w, c, (c >> 1) | e, &h0[r + 1], &h1[r + 1]);
+  }
+  for (int i = 0; i < SB_CHUNK; i++) {
+    uint64_t alive = n[1][1] != NULL ? n[1][1]->bits[i] : 0;
+    out->bits[i] = PB_life(h0[i], h1[i], h0[i + 1], h1[i + 1], h0[i + 2],
+                           h1[i + 2], alive);
+    any |= out->bits[i];
+  }
+  return any != 0;
+}
+
+/**
+ * Updates the sparse board to the next time unit t + 1. Every chunk is
+ * computed, plus each missing neighbour one of its border cells could bring to
+ * life; only chunks with alive cells are kept. The map of the next
+ * generation is sized from the chunks of this one, so it shrinks back when
+ * the population falls.
+ * @param sparse Pointer to the sparse board
+ * @return The same pointer to the sparse board
+ */
+SparseBoard *SB_step(SparseBoard *sparse) {
+  SB_Map *map = &sparse->map, *next = &sparse->next;
+
+  _map_clear(next, map->count);
+  for (size_t k = 0; k < map->capacity; k++) {
+    SB_Entry entry = map->entries[k];
+    if (entry.chunk == NULL)
+      continue;
+    for (int dr = -1; dr <= 1; dr++) {
+      for (int dc = -1; dc <= 1; dc++) {
+        int64_t row = entry.row + dr, col = entry.col + dc;
+        // Chunks of the map are computed when the loop reaches them
+        if ((dr != 0 || dc != 0) &&
+            (_map_get(map, row, col) != NULL || !_reaches(entry.chunk, dr, dc)))
+          continue;
+        if (_map_get(next, row, col) != NULL)
+          continue;
+        SB_Chunk *chunk = _chunk_alloc(sparse);
+        if (_next_chunk(sparse, row, col, chunk))
+          _map_put(next, row, col, chunk);
+        else
+          _chunk_free(sparse, chunk);
+      }
+    }
+  }
+
+  for (size_t k = 0; k < map->capacity; k++)
+    if (map->entries[k].chunk != NULL)
+      _chunk_free(sparse, map->entries[k].chunk);
+  SB_Map current = *map;
+  *map = *next;
+  *next = current;
+  sparse->generation++;
+  return sparse;
+}
+
+/**
+ * Makes the cell at given coordinates of the plane alive
+ * @param sparse Pointer to the sparse board
+ * @param row Row of the cell
+ * @param col Column of the cell
+ */
+void SB_set_alive(SparseBoard *sparse, int64_t row, int64_t col) {
+  int64_t r = _chunk_of(row), c = _chunk_of(col);
+  SB_Chunk *chunk = _map_get(&sparse->map, r, c);
+  if (chunk == NULL) {
+    chunk = _chunk_alloc(sparse);
+    memset(chunk->bits, 0, sizeof(chunk->bits));
+    _map_put(&sparse->map, r, c, chunk);
+  }
+  chunk->bits[row & (SB_CHUNK - 1)] |= (uint64_t)1 << (col & (SB_CHUNK - 1));
+}
+
+/**
+ * Makes the cell at given coordinates of the plane dead. A chunk left empty
+ * is dropped by the next step.
+ * @param sparse Pointer to the sparse board
+ * @param row Row of the cell
+ * @param col Column of the cell
+ */
+void SB_set_dead(SparseBoard *sparse, int64_t row, int64_t col) {
+  SB_Chunk *chunk = _map_get(&sparse->map, _chunk_of(row), _chunk_of(col));
+  if (chunk != NULL)
+    chunk->bits[row & (SB_CHUNK - 1)] &=
+        ~((uint64_t)1 << (col & (SB_CHUNK - 1)));
+}
+
+/**
+ * Checks if the cell at given coordinates of the plane is alive
+ * @param sparse Pointer to the sparse board
+ * @param row Row of the cell
+ * @param col Column of the cell
+ * @return 1 If the cell is alive. Otherwise return 0.
+ */
+int SB_is_alive(SparseBoard *sparse, int64_t row, int64_t col) {
+  SB_Chunk *chunk = _map_get(&sparse->map, _chunk_of(row), _chunk_of(col));
+  return chunk != NULL &&
+         ((chunk->bits[row & (SB_CHUNK - 1)] >> (col & (SB_CHUNK - 1))) & 1);
+}
+
+/**
+ * Returns the number of alive cells on the plane
+ * @param sparse Pointer to the sparse board
+ * @return Population
+ */
+uint64_t SB_population(SparseBoard *sparse) {
+  uint64_t population = 0;
+  for (size_t k = 0; k < sparse->map.capacity; k++) {
+    SB_Chunk *chunk = sparse->map.entries[k].chunk;
+    if (chunk != NULL)
+      for (int i = 0; i < SB_CHUNK; i++)
+        population += (uint64_t)__builtin_popcountll(chunk->bits[i]);
+  }
+  return population;
+}
+
+/**
+ * Returns the number of chunks in use
+ * @param sparse Pointer to the sparse board
+ * @return Number of chunks
+ */
+size_t SB_chunks(SparseBoard *sparse) { return sparse->map.count; }
+
+/**
+ * Frees the memory allocated by the given sparse board.
+ * @param sparse Pointer to the sparse board
+ */
+void SB_destroy(SparseBoard *sparse) {
+  if (sparse == NULL) {
+    printf("SB_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  for (size_t k = 0; k < sparse->map.capacity; k++)
+    if (sparse->map.entries[k].chunk != NULL)
+      _chunk_free(sparse, sparse->map.entries[k].chunk);
+  while (sparse->free != NULL) {
+    SB_Chunk *next = sparse->free->next;
+    free(sparse->free);
+    sparse->free = next;
+  }
+  free(sparse->map.entries);
+  free(sparse->next.entries);
+  free(sparse);
+}
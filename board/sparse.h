@@ -0,0 +1,66 @@
+/**
+ * @file sparse.h
+ * @brief Header file for the unbounded sparse board: a map of 64x64 chunks
+ * of cells keyed by chunk coordinates, holding only the live areas of the
+ * plane
+ */
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <board.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Side in cells of a chunk, one 64-bit word per row */
+#define SB_CHUNK (64)
+
+/** Number of empty chunks kept for reuse, the others are freed */
+#define SB_FREE_CHUNKS (64)
+
+/** Square of SB_CHUNK x SB_CHUNK cells, bit j of bits[i] being the cell at
+ * row i and column j of the chunk */
+typedef struct SB_Chunk {
+  uint64_t bits[SB_CHUNK]; /**< Rows of cells */
+  struct SB_Chunk *next;   /**< Next chunk in the free list */
+} SB_Chunk;
+
+/** Entry of the chunk map, empty when chunk is NULL */
+typedef struct {
+  int64_t row;     /**< Chunk row, the cell row divided by SB_CHUNK */
+  int64_t col;     /**< Chunk column, the cell column divided by SB_CHUNK */
+  SB_Chunk *chunk; /**< Cells of the chunk */
+} SB_Entry;
+
+/** Open addressing hash map from chunk coordinates to chunks */
+typedef struct {
+  SB_Entry *entries; /**< Slots, a power of two of them */
+  size_t capacity;   /**< Number of slots */
+  size_t count;      /**< Number of used slots */
+} SB_Map;
+
+/** Unbounded board. A step computes the next generation of every chunk and
+ * of the neighbouring chunks its border cells reach into a second map; chunks
+ * that end up empty are not kept: up to SB_FREE_CHUNKS of them wait in the
+ * free list and the others are freed. The maps are sized from the number of
+ * chunks at every step, so memory and the cost of a step follow the current
+ * population rather than the largest one. */
+typedef struct {
+  SB_Map map;          /**< Chunks of the current generation */
+  SB_Map next;         /**< Chunks of the generation being computed */
+  SB_Chunk *free;      /**< Chunks ready to be reused */
+  size_t spare;        /**< Number of chunks in the free list */
+  uint64_t generation; /**< Number of generations computed so far */
+} SparseBoard;
+
+SparseBoard *SB_new(void);
+SparseBoard *SB_from_board(Board *board, int64_t row, int64_t col);
+Board *SB_to_board(SparseBoard *sparse, Board *board, int64_t row,
+                   int64_t col);
+SparseBoard *SB_step(SparseBoard *sparse);
+void SB_set_alive(SparseBoard *sparse, int64_t row, int64_t col);
+void SB_set_dead(SparseBoard *sparse, int64_t row, int64_t col);
+int SB_is_alive(SparseBoard *sparse, int64_t row, int64_t col);
+uint64_t SB_population(SparseBoard *sparse);
+size_t SB_chunks(SparseBoard *sparse);
+void SB_destroy(SparseBoard *sparse);
+#endif
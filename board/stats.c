@@ -0,0 +1,243 @@
+/**
+ * @file stats.c
+ * @brief Contains the gathering of the statistics of the steps and their
+ * writing as CSV or JSON lines. The counts are added by the update kernel
+ * itself, once per band or tile, so gathering them does not go through the
+ * board again.
+ */
+#include <limits.h>
+#include <stats.h>
+#include <stdlib.h>
+#include <time.h>
+
+/** Names of the phases in the files, in the order of StatsPhase */
+static const char *phase_names[ST_PHASES] = {"count", "rule", "render",
+                                             "alloc"};
+
+/**
+ * Creates a collector of statistics
+ * @param file File every generation is written to, NULL to keep only the
+ * last one in the collector. The header of a CSV file is written at once.
+ * @param format ST_CSV or ST_JSONL
+ * @param timing 1 to measure the time of the phases, which costs a few
+ * clock readings per band of cells
+ * @return Pointer to the collector
+ */
+StatsCollector *ST_new(FILE *file, StatsFormat format, int timing) {
+  StatsCollector *stats = (StatsCollector *)calloc(1, sizeof(StatsCollector));
+  if (stats == NULL) {
+    printf("ST_new: Could not allocate the collector\nExiting...\n");
+    exit(1);
+  }
+  stats->file = file;
+  stats->format = format;
+  stats->timing = timing;
+  stats->last.top = stats->last.left = -1;
+  stats->last.bottom = stats->last.right = -1;
+  for (int k = 0; k < ST_PHASES; k++)
+    atomic_init(&stats->nanoseconds[k], 0);
+  ST_begin(stats);
+  if (file != NULL)
+    ST_header(file, format);
+  return stats;
+}
+
+/**
+ * Starts the counts of a new generation
+ * @param stats Pointer to the collector
+ */
+void ST_begin(StatsCollector *stats) {
+  atomic_store(&stats->population, 0);
+  atomic_store(&stats->births, 0);
+  atomic_store(&stats->deaths, 0);
+  atomic_store(&stats->top, INT_MAX);
+  atomic_store(&stats->left, INT_MAX);
+  atomic_store(&stats->bottom, -1);
+  atomic_store(&stats->right, -1);
+}
+
+/**
+ * Lowers an atomic value to the given one if it is above
+ * @param value Pointer to the atomic value
+ * @param bound The new value
+ */
+static void _lower(atomic_int *value, int bound) {
+  int current = atomic_load(value);
+  while (bound < current &&
+         !atomic_compare_exchange_weak(value, &current, bound))
+    ;
+}
+
+/**
+ * Raises an atomic value to the given one if it is below
+ * @param value Pointer to the atomic value
+ * @param bound The new value
+ */
+static void _raise(atomic_int *value, int bound) {
+  int current = atomic_load(value);
+  while (bound > current &&
+         !atomic_compare_exchange_weak(value, &current, bound))
+    ;
+}
+
+/**
+ * Adds the counts of a part of the board to the generation being stepped.
+ * Threads may add their parts at the same time.
+ * @param stats Pointer to the collector
+ * @param part Counts and times of the part, top being -1 if it has no alive
+ * cell. Its generation is ignored.
+ */
+void ST_add(StatsCollector *stats, const Stats *part) {
+  atomic_fetch_add(&stats->population, part->population);
+  atomic_fetch_add(&stats->births, part->births);
+  atomic_fetch_add(&stats->deaths, part->deaths);
+  if (part->top >= 0) {
+    _lower(&stats->top, part->top);
+    _lower(&stats->left, part->left);
+    _raise(&stats->bottom, part->bottom);
+    _raise(&stats->right, part->right);
+  }
+  for (int k = 0; k < ST_PHASES; k++)
+    if (part->seconds[k] > 0)
+      ST_time(stats, (StatsPhase)k, part->seconds[k]);
+}
+
+/**
+ * Takes the time of a phase measured since the last generation ended
+ * @param stats Pointer to the collector
+ * @param phase The phase
+ * @return Time in seconds, the measure starting again from 0
+ */
+static double _take(StatsCollector *stats, StatsPhase phase) {
+  return (double)atomic_exchange(&stats->nanoseconds[phase], 0) * 1e-9;
+}
+
+/**
+ * Ends the generation being stepped: the previous one is written to the
+ * file with the time spent drawing it, and this one becomes the last one
+ * @param stats Pointer to the collector
+ */
+void ST_end(StatsCollector *stats) {
+  // Drawing before the first step belongs to no generation
+  if (stats->pending)
+    ST_flush(stats);
+  else
+    _take(stats, ST_RENDER);
+  Stats *last = &stats->last;
+  last->generation = ++stats->generation;
+  last->population = atomic_load(&stats->population);
+  last->births = atomic_load(&stats->births);
+  last->deaths = atomic_load(&stats->deaths);
+  last->top = last->population > 0 ? atomic_load(&stats->top) : -1;
+  last->left = last->population > 0 ? atomic_load(&stats->left) : -1;
+  last->bottom = last->population > 0 ? atomic_load(&stats->bottom) : -1;
+  last->right = last->population > 0 ? atomic_load(&stats->right) : -1;
+  for (int k = 0; k < ST_PHASES; k++)
+    last->seconds[k] = k == ST_RENDER ? 0 : _take(stats, (StatsPhase)k);
+  stats->pending = 1;
+}
+
+/**
+ * Adds time spent in a phase to the generation being stepped, or for
+ * ST_RENDER to the last one. Threads may add time at the same time.
+ * @param stats Pointer to the collector
+ * @param phase The phase
+ * @param seconds Time in seconds
+ */
+void ST_time(StatsCollector *stats, StatsPhase phase, double seconds) {
+  atomic_fetch_add(&stats->nanoseconds[phase], (long long)(seconds * 1e9));
+}
+
+/**
+ * Returns a monotonic time stamp for the measures of the phases
+ * @return Time in seconds
+ */
+double ST_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Writes the header line of a CSV file, nothing for JSON lines
+ * @param file The file
+ * @param format ST_CSV or ST_JSONL
+ */
+void ST_header(FILE *file, StatsFormat format) {
+  if (format != ST_CSV)
+    return;
+  fprintf(file, "generation,population,births,deaths,top,left,bottom,right");
+  for (int k = 0; k < ST_PHASES; k++)
+    fprintf(file, ",%s_seconds", phase_names[k]);
+  fprintf(file, "\n");
+}
+
+/**
+ * Writes the statistics of a generation as a line of the file
+ * @param file The file
+ * @param format ST_CSV or ST_JSONL
+ * @param stats Pointer to the statistics
+ * @return 0 on success, -1 if the line could not be written
+ */
+int ST_write(FILE *file, StatsFormat format, const Stats *stats) {
+  int failed;
+  if (format == ST_CSV) {
+    failed = fprintf(file, "%llu,%lld,%lld,%lld,%d,%d,%d,%d",
+                     (unsigned long long)stats->generation, stats->population,
+                     stats->births, stats->deaths, stats->top, stats->left,
+                     stats->bottom, stats->right) < 0;
+    for (int k = 0; k < ST_PHASES; k++)
+      failed |= fprintf(file, ",%.9f", stats->seconds[k]) < 0;
+  } else {
+    failed = fprintf(file,
+                     "{\"generation\":%llu,\"population\":%lld,\"births\":%lld,"
+                     "\"deaths\":%lld,\"top\":%d,\"left\":%d,\"bottom\":%d,"
+                     "\"right\":%d",
+                     (unsigned long long)stats->generation, stats->population,
+                     stats->births, stats->deaths, stats->top, stats->left,
+                     stats->bottom, stats->right) < 0;
+    for (int k = 0; k < ST_PHASES; k++)
+      failed |= fprintf(file, ",\"%s_seconds\":%.9f", phase_names[k],
+                        stats->seconds[k]) < 0;
+    failed |= fprintf(file, "}") < 0;
+  }
+  failed |= fprintf(file, "\n") < 0;
+  return failed ? -1 : 0;
+}
+
+/**
+ * Writes the last generation to the file if it was not written yet, with the
+ * time spent drawing it so far
+ * @param stats Pointer to the collector
+ * @return 0 on success, -1 if the line could not be written
+ */
+int ST_flush(StatsCollector *stats) {
+  if (!stats->pending)
+    return 0;
+  stats->pending = 0;
+  stats->last.seconds[ST_RENDER] = _take(stats, ST_RENDER);
+  if (stats->file == NULL)
+    return 0;
+  if (ST_write(stats->file, stats->format, &stats->last) != 0) {
+    printf("ST_flush: Could not write generation %llu\n",
+           (unsigned long long)stats->last.generation);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Writes the last generation and frees the collector. The file is not
+ * closed.
+ * @param stats Pointer to the collector
+ */
+void ST_destroy(StatsCollector *stats) {
+  if (stats == NULL) {
+    printf("ST_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  ST_flush(stats);
+  if (stats->file != NULL)
+    fflush(stats->file);
+  free(stats);
+}
@@ -0,0 +1,74 @@
+/**
+ * @file stats.h
+ * @brief Header file for the statistics gathered by the steps of a board and
+ * their streaming to CSV or JSON lines files
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Phases whose time is measured */
+typedef enum {
+  ST_COUNT,  /**< Sums of the neighbours of the cells */
+  ST_RULE,   /**< Lookup of the next states in the rule */
+  ST_RENDER, /**< Drawing of the board, measured by the display */
+  ST_ALLOC,  /**< Allocation of the new board of B_update */
+  ST_PHASES  /**< Number of phases */
+} StatsPhase;
+
+/** Formats of the statistics files */
+typedef enum {
+  ST_CSV,  /**< A header line and a line per generation */
+  ST_JSONL /**< One JSON object per generation */
+} StatsFormat;
+
+/** Statistics of one generation */
+typedef struct {
+  uint64_t generation;       /**< Number of the generation */
+  long long population;      /**< Number of alive cells */
+  long long births;          /**< Cells alive now and not before the step */
+  long long deaths;          /**< Cells alive before the step and not now */
+  int top;                   /**< First row with an alive cell, -1 if none */
+  int left;                  /**< First column with an alive cell */
+  int bottom;                /**< Last row with an alive cell */
+  int right;                 /**< Last column with an alive cell */
+  double seconds[ST_PHASES]; /**< Time spent in every phase */
+} Stats;
+
+/** Gathers the statistics of the steps of a board. The threads stepping bands
+ * of the board add their own counts once per band, and every generation is
+ * written to the file when the next one ends, so the time spent drawing it
+ * is part of its line. */
+typedef struct {
+  FILE *file;               /**< File the generations are written to, or
+                               NULL */
+  StatsFormat format;       /**< Format of the file */
+  int timing;               /**< Set to measure the time of the phases */
+  uint64_t generation;      /**< Number of generations stepped so far */
+  int pending;              /**< Set when last was not written yet */
+  Stats last;               /**< Statistics of the last generation stepped */
+  atomic_llong population;  /**< Population of the generation being stepped */
+  atomic_llong births;      /**< Births of the generation being stepped */
+  atomic_llong deaths;      /**< Deaths of the generation being stepped */
+  atomic_int top;           /**< First row with an alive cell so far */
+  atomic_int left;          /**< First column with an alive cell so far */
+  atomic_int bottom;        /**< Last row with an alive cell so far */
+  atomic_int right;         /**< Last column with an alive cell so far */
+  atomic_llong nanoseconds[ST_PHASES]; /**< Time of the phases since the
+                                          last generation ended */
+} StatsCollector;
+
+StatsCollector *ST_new(FILE *file, StatsFormat format, int timing);
+void ST_begin(StatsCollector *stats);
+void ST_add(StatsCollector *stats, const Stats *part);
+void ST_end(StatsCollector *stats);
+void ST_time(StatsCollector *stats, StatsPhase phase, double seconds);
+double ST_now(void);
+void ST_header(FILE *file, StatsFormat format);
+int ST_write(FILE *file, StatsFormat format, const Stats *stats);
+int ST_flush(StatsCollector *stats);
+void ST_destroy(StatsCollector *stats);
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file triple.c
+ * @brief Contains the lock-free triple buffer. Only one thread may publish
+ * and only one thread may acquire.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <triple.h>
+
+/**
+ * Creates a triple buffer whose three slots are zeroed
+ * @param size Number of bytes of a slot
+ * @return Pointer to the triple buffer
+ */
+TripleBuffer *TB_new(size_t size) {
+  TripleBuffer *buffer = (TripleBuffer *)malloc(sizeof(TripleBuffer));
+  if (buffer == NULL) {
+    printf("TB_new: Could not allocate the buffer\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < 3; k++) {
+    buffer->slots[k] = (unsigned char *)calloc(size > 0 ? size : 1, 1);
+    if (buffer->slots[k] == NULL) {
+      printf("TB_new: Could not allocate a slot\nExiting...\n");
+      exit(1);
+    }
+  }
+  buffer->size = size;
+  buffer->back = 0;
+  atomic_init(&buffer->middle, 1u);
+  buffer->front = 2;
+  return buffer;
+}
+
+/**
+ * Returns the slot the producer writes the next state into
+ * @param buffer Pointer to the triple buffer
+ * @return Pointer to the back slot
+ */
+void *TB_back(TripleBuffer *buffer) { return buffer->slots[buffer->back]; }
+
+/**
+ * Makes the back slot the latest state, and takes the previous middle slot
+ * as the new back slot. Called by the producer only.
+ * @param buffer Pointer to the triple buffer
+ */
+void TB_publish(TripleBuffer *buffer) {
+  unsigned int middle =
+      atomic_exchange_explicit(&buffer->middle, buffer->back | TB_FRESH,
+                               memory_order_acq_rel);
+  buffer->back = middle & ~TB_FRESH;
+}
+
+/**
+ * Returns the latest published state. The front slot is only swapped when a
+ * newer state was published, so it stays valid until the next call. Called
+ * by the consumer only.
+ * @param buffer Pointer to the triple buffer
+ * @param fresh Set to 1 if the state is new since the last call, 0
+ * otherwise. May be NULL.
+ * @return Pointer to the front slot
+ */
+void *TB_acquire(TripleBuffer *buffer, int *fresh) {
+  int swapped = 0;
+  if (atomic_load_explicit(&buffer->middle, memory_order_relaxed) & TB_FRESH) {
+    unsigned int middle = atomic_exchange_explicit(
+        &buffer->middle, buffer->front, memory_order_acq_rel);
+    buffer->front = middle & ~TB_FRESH;
+    swapped = 1;
+  }
+  if (fresh != NULL)
+    *fresh = swapped;
+  return buffer->slots[buffer->front];
+}
+
+/**
+ * Frees the memory allocated by the given triple buffer.
+ * @param buffer Pointer to the triple buffer
+ */
+void TB_destroy(TripleBuffer *buffer) {
+  if (buffer == NULL) {
+    printf("TB_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  for (int k = 0; k < 3; k++)
+    free(buffer->slots[k]);
+  free(buffer);
+}
@@ -0,0 +1,32 @@
+/**
+ * @file triple.h
+ * @brief Header file for the lock-free triple buffer handing the latest
+ * generation from the thread stepping a board to the thread drawing it
+ */
+#ifndef TRIPLE_H
+#define TRIPLE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+/** Flag of the middle slot telling it was published and not acquired yet */
+#define TB_FRESH (4u)
+
+/** Three slots of the same size. The producer writes the back slot and the
+ * consumer reads the front slot while the middle one holds the latest
+ * published state; publishing and acquiring swap a slot with the middle one,
+ * so neither thread ever waits for the other. */
+typedef struct {
+  unsigned char *slots[3]; /**< The three slots */
+  size_t size;             /**< Number of bytes of a slot */
+  atomic_uint middle;      /**< Index of the middle slot, with TB_FRESH */
+  unsigned int back;       /**< Index of the slot of the producer */
+  unsigned int front;      /**< Index of the slot of the consumer */
+} TripleBuffer;
+
+TripleBuffer *TB_new(size_t size);
+void *TB_back(TripleBuffer *buffer);
+void TB_publish(TripleBuffer *buffer);
+void *TB_acquire(TripleBuffer *buffer, int *fresh);
+void TB_destroy(TripleBuffer *buffer);
+#endif
@@ -8,6 +8,7 @@
 #define  _CRT_SECURE_NO_WARNINGS 1
 #include <windows.h>
 #else
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 #endif
@@ -58,14 +59,29 @@ void setup_console() {
  * Set console config to default for Windows
  */
 void restore_console() {
-    // Reset colors
-    printf("\x1b[0m");    
+    // Reset colors and show the cursor hidden by the frames
+    printf("\x1b[0m\x1b[?25h");    
     
     // Reset console mode
     if(!SetConsoleMode(stdoutHandle, outModeInit) || !SetConsoleMode(stdinHandle, inModeInit)) {
         exit(GetLastError());
     }
 }
+
+/**
+ * Gets the size of the console window for Windows
+ * @param rows Receives the number of rows
+ * @param cols Receives the number of columns
+ */
+void console_size(int *rows, int *cols) {
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    *rows = 24;
+    *cols = 80;
+    if(GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+        *cols = info.srWindow.Right - info.srWindow.Left + 1;
+    }
+}
 #else
 
 static struct termios orig_term;
@@ -87,10 +103,26 @@ void setup_console() {
  * Set console config to default for MacOS and Linux
  */
 void restore_console() {
-    // Reset colors
-    printf("\x1b[0m");
+    // Reset colors and show the cursor hidden by the frames
+    printf("\x1b[0m\x1b[?25h");
 
     // Reset console mode
     tcsetattr(STDIN_FILENO, TCSANOW, &orig_term);
 }
+
+/**
+ * Gets the size of the terminal for MacOS and Linux, 24x80 when the output
+ * is not a terminal
+ * @param rows Receives the number of rows
+ * @param cols Receives the number of columns
+ */
+void console_size(int *rows, int *cols) {
+    struct winsize ws;
+    *rows = 24;
+    *cols = 80;
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        *rows = ws.ws_row;
+        *cols = ws.ws_col;
+    }
+}
 #endif
\ No newline at end of file
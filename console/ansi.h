@@ -32,6 +32,7 @@ enum Colors {
 
 void setup_console();
 void restore_console();
+void console_size(int *rows, int *cols);
 /**
  * Sets the text color of console to given color
  * @param code ANSI code of the color
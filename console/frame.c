@@ -0,0 +1,391 @@
+/**
+ * @file frame.c
+ * @brief Source file for the buffered terminal renderer. A frame is built in
+ * one buffer and written with a single write(), and only the characters whose
+ * key changed since the previous frame are redrawn.
+ *
+ * The view is cut into dots, squares of zoom x zoom cells shaded by the part
+ * of their cells that are alive. Depending on the mode a character shows one
+ * dot (two spaces), two dots (upper half block with a foreground and a
+ * background colour) or eight dots (braille pattern).
+ */
+
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
+
+#include <ansi.h>
+#include <frame.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** 256-colour codes of the shades of the dots, from white to red */
+static const int shades[F_LEVELS] = {231, 224, 217, 210, 203, 196};
+
+/** Bits of the braille pattern of every dot of a character, by row */
+static const int braille[4][2] = {
+    {0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}};
+
+/**
+ * Makes room for the given number of bytes at the end of the buffer
+ * @param frame Pointer to the frame
+ * @param size Number of bytes to append
+ */
+static void _reserve(Frame *frame, size_t size) {
+  if (frame->length + size <= frame->capacity)
+    return;
+  size_t capacity = frame->capacity * 2;
+  if (capacity < frame->length + size)
+    capacity = frame->length + size;
+  char *buffer = (char *)realloc(frame->buffer, capacity);
+  if (buffer == NULL) {
+    printf("Frame: Could not allocate the buffer\nExiting...\n");
+    exit(1);
+  }
+  frame->buffer = buffer;
+  frame->capacity = capacity;
+}
+
+/**
+ * Appends bytes to the buffer
+ * @param frame Pointer to the frame
+ * @param text Bytes to append
+ * @param size Number of bytes
+ */
+static void _append(Frame *frame, const char *text, size_t size) {
+  _reserve(frame, size);
+  memcpy(frame->buffer + frame->length, text, size);
+  frame->length += size;
+}
+
+/**
+ * Appends a positive number in decimal to the buffer
+ * @param frame Pointer to the frame
+ * @param n The number
+ */
+static void _append_number(Frame *frame, int n) {
+  char digits[12];
+  int k = sizeof(digits);
+  do {
+    digits[--k] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n > 0);
+  _append(frame, digits + k, sizeof(digits) - k);
+}
+
+/**
+ * Appends the escape sequence setting the colour of the next characters to
+ * the shade of a dot. Dead and fully alive dots use the basic colours.
+ * @param frame Pointer to the frame
+ * @param level Shade of the dot, from 0 to F_LEVELS - 1
+ * @param background 1 to set the background colour, 0 for the foreground
+ */
+static void _append_color(Frame *frame, int level, int background) {
+  _append(frame, "\x1b[", 2);
+  if (level == 0) {
+    _append_number(frame, background ? WHITE_BKG : WHITE_TXT);
+  } else if (level == F_LEVELS - 1) {
+    _append_number(frame, background ? RED_BKG : RED_TXT);
+  } else {
+    _append(frame, background ? "48;5;" : "38;5;", 5);
+    _append_number(frame, shades[level]);
+  }
+  _append(frame, "m", 1);
+}
+
+/**
+ * Appends the escape sequence moving the cursor
+ * @param frame Pointer to the frame
+ * @param row Terminal row, starting from 1
+ * @param col Terminal column, starting from 1
+ */
+static void _append_move(Frame *frame, int row, int col) {
+  _append(frame, "\x1b[", 2);
+  _append_number(frame, row);
+  _append(frame, ";", 1);
+  _append_number(frame, col);
+  _append(frame, "H", 1);
+}
+
+/**
+ * Appends the character of the given key, changing the colours it needs
+ * @param frame Pointer to the frame
+ * @param key Key of the character, see _key
+ * @param fg Foreground shade currently set, updated
+ * @param bg Background shade currently set, updated
+ */
+static void _append_glyph(Frame *frame, int key, int *fg, int *bg) {
+  int back = key, front = -1;
+  if (frame->mode == F_HALF && key / F_LEVELS != key % F_LEVELS) {
+    back = key % F_LEVELS;
+    front = key / F_LEVELS;
+  } else if (frame->mode == F_HALF) {
+    back = key % F_LEVELS;
+  } else if (frame->mode == F_BRAILLE) {
+    back = 0;
+    front = key != 0 ? F_LEVELS - 1 : -1;
+  }
+
+  if (back != *bg)
+    _append_color(frame, *bg = back, 1);
+  if (front >= 0 && front != *fg)
+    _append_color(frame, *fg = front, 0);
+
+  if (frame->mode == F_BLOCK) {
+    _append(frame, "  ", 2);
+  } else if (front < 0) {
+    _append(frame, " ", 1);
+  } else if (frame->mode == F_HALF) {
+    _append(frame, "\xe2\x96\x80", 3);
+  } else {
+    char glyph[3] = {(char)0xe2, (char)(0xa0 | (key >> 6)),
+                     (char)(0x80 | (key & 0x3f))};
+    _append(frame, glyph, 3);
+  }
+}
+
+/**
+ * Returns the shade of a dot of the view. Cells outside the board are dead,
+ * and a dot with any alive cell is at least at the first shade.
+ * @param frame Pointer to the frame
+ * @param board The board shown
+ * @param row Row of the dot in the view
+ * @param col Column of the dot in the view
+ * @return Shade of the dot, from 0 to F_LEVELS - 1
+ */
+static int _level(Frame *frame, Board *board, int row, int col) {
+  int zoom = frame->zoom;
+  int top = frame->row + row * zoom, left = frame->col + col * zoom;
+  int bottom = top + zoom, right = left + zoom, alive = 0;
+
+  if (top < 0)
+    top = 0;
+  if (left < 0)
+    left = 0;
+  if (bottom > board->height)
+    bottom = board->height;
+  if (right > board->width)
+    right = board->width;
+  for (int i = top; i < bottom; i++)
+    for (int j = left; j < right; j++)
+      alive += board->cell[i][j] == ALIVE;
+  return (alive * (F_LEVELS - 1) + zoom * zoom - 1) / (zoom * zoom);
+}
+
+/**
+ * Returns the key of a character, which tells everything it shows: the shade
+ * of its dot, the shades of its two dots, or the braille pattern of its
+ * eight dots
+ * @param frame Pointer to the frame
+ * @param board The board shown
+ * @param row Row of the character in the frame
+ * @param col Column of the character in the frame
+ * @return Key of the character
+ */
+static int _key(Frame *frame, Board *board, int row, int col) {
+  if (frame->mode == F_BLOCK)
+    return _level(frame, board, row, col);
+  if (frame->mode == F_HALF)
+    return _level(frame, board, 2 * row, col) * F_LEVELS +
+           _level(frame, board, 2 * row + 1, col);
+
+  int key = 0;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 2; j++)
+      if (_level(frame, board, 4 * row + i, 2 * col + j) > 0)
+        key |= braille[i][j];
+  return key;
+}
+
+/**
+ * Creates a frame drawing the board from its top left cell, one dot per
+ * cell in F_BLOCK mode. Its first redraw clears the screen.
+ * @param height Number of rows of characters drawn
+ * @param width Number of characters drawn per row
+ * @param top Terminal row of the first row of characters, the rows above it
+ * are left to the status line
+ * @return Pointer to the frame
+ */
+Frame *F_new(int height, int width, int top) {
+  Frame *frame = (Frame *)malloc(sizeof(Frame));
+  if (frame == NULL) {
+    printf("F_new: Could not allocate the frame\nExiting...\n");
+    exit(1);
+  }
+  frame->top = top;
+  frame->mode = F_BLOCK;
+  frame->row = 0;
+  frame->col = 0;
+  frame->zoom = 1;
+  frame->shown = NULL;
+  frame->buffer = NULL;
+  frame->length = 0;
+  frame->capacity = 0;
+  F_resize(frame, height, width);
+  return frame;
+}
+
+/**
+ * Changes the number of characters drawn, e.g. after the terminal was
+ * resized. The whole screen is redrawn by the next frame.
+ * @param frame Pointer to the frame
+ * @param height Number of rows of characters drawn
+ * @param width Number of characters drawn per row
+ */
+void F_resize(Frame *frame, int height, int width) {
+  uint16_t *shown = (uint16_t *)realloc(
+      frame->shown, (size_t)(height > 0 ? height : 1) * (width > 0 ? width : 1) *
+                        sizeof(uint16_t));
+  if (shown == NULL) {
+    printf("F_resize: Could not allocate the characters\nExiting...\n");
+    exit(1);
+  }
+  frame->shown = shown;
+  frame->height = height > 0 ? height : 0;
+  frame->width = width > 0 ? width : 0;
+  F_invalidate(frame);
+}
+
+/**
+ * Changes the way dots are drawn. The whole screen is redrawn by the next
+ * frame.
+ * @param frame Pointer to the frame
+ * @param mode The new mode
+ */
+void F_set_mode(Frame *frame, RenderMode mode) {
+  if (frame->mode == mode)
+    return;
+  frame->mode = mode;
+  F_invalidate(frame);
+}
+
+/**
+ * Moves the view over the board. Only the characters whose dots changed are
+ * redrawn by the next frame.
+ * @param frame Pointer to the frame
+ * @param row Row of the board at the top of the view
+ * @param col Column of the board at the left of the view
+ * @param zoom Side of the square of cells shaded into one dot, at least 1
+ */
+void F_set_view(Frame *frame, int row, int col, int zoom) {
+  frame->row = row;
+  frame->col = col;
+  frame->zoom = zoom > 1 ? zoom : 1;
+}
+
+/**
+ * Returns the number of rows of dots of a character in the current mode
+ * @param frame Pointer to the frame
+ * @return 1, 2 or 4
+ */
+int F_dots_high(Frame *frame) {
+  return frame->mode == F_BRAILLE ? 4 : frame->mode == F_HALF ? 2 : 1;
+}
+
+/**
+ * Returns the number of columns of dots of a character in the current mode
+ * @param frame Pointer to the frame
+ * @return 1 or 2
+ */
+int F_dots_wide(Frame *frame) { return frame->mode == F_BRAILLE ? 2 : 1; }
+
+/**
+ * Forgets what is on the screen, so the next frame clears it and redraws
+ * every character
+ * @param frame Pointer to the frame
+ */
+void F_invalidate(Frame *frame) {
+  for (size_t k = 0; k < (size_t)frame->height * frame->width; k++)
+    frame->shown[k] = F_UNKNOWN;
+  frame->stale = 1;
+}
+
+/**
+ * Builds the escape sequences turning the screen into the view of the given
+ * board, without writing them. Changed characters are found by comparing
+ * keys with the ones on the screen; consecutive characters of one colour
+ * share a single colour change, and short runs of unchanged characters are
+ * redrawn rather than jumped over with a longer cursor move.
+ * @param frame Pointer to the frame
+ * @param board The board shown
+ * @param status Text of the first terminal row, NULL to leave it
+ * @return Number of bytes in frame->buffer
+ */
+size_t F_build(Frame *frame, Board *board, const char *status) {
+  int columns = frame->mode == F_BLOCK ? 2 : 1;
+  int fg = -1, bg = -1, row = -1, col = -1;
+
+  frame->length = 0;
+  if (frame->stale)
+    _append(frame, "\x1b[?25l\x1b[0m\x1b[2J", 14);
+  frame->stale = 0;
+  if (status != NULL) {
+    _append(frame, "\x1b[H\x1b[0m", 7);
+    _append(frame, status, strlen(status));
+    _append(frame, "\x1b[K", 3);
+  }
+
+  for (int i = 0; i < frame->height; i++) {
+    uint16_t *shown = frame->shown + (size_t)i * frame->width;
+    for (int j = 0; j < frame->width; j++) {
+      int key = _key(frame, board, i, j);
+      if (shown[j] == key)
+        continue;
+
+      // col is the next character the cursor is on
+      if (row != i || col > j || j - col > F_GAP) {
+        _append_move(frame, frame->top + i, columns * j + 1);
+      } else {
+        for (; col < j; col++)
+          _append_glyph(frame, shown[col], &fg, &bg);
+      }
+      _append_glyph(frame, key, &fg, &bg);
+      shown[j] = (uint16_t)key;
+      row = i;
+      col = j + 1;
+    }
+  }
+
+  _append(frame, "\x1b[0m", 4);
+  _append_move(frame, frame->top + frame->height, 1);
+  return frame->length;
+}
+
+/**
+ * Builds the frame and writes it to the standard output at once
+ * @param frame Pointer to the frame
+ * @param board The board shown
+ * @param status Text of the first terminal row, NULL to leave it
+ * @return Number of bytes written
+ */
+size_t F_render(Frame *frame, Board *board, const char *status) {
+  size_t length = F_build(frame, board, status);
+  size_t written = 0;
+
+  fflush(stdout);
+  while (written < length) {
+    long n = (long)write(1, frame->buffer + written, length - written);
+    if (n <= 0)
+      break;
+    written += (size_t)n;
+  }
+  return written;
+}
+
+/**
+ * Frees the memory allocated by the given frame.
+ * @param frame Pointer to the frame
+ */
+void F_destroy(Frame *frame) {
+  if (frame == NULL) {
+    printf("F_destroy: Passed value is NULL\nExiting...\n");
+    exit(1);
+  }
+  free(frame->shown);
+  free(frame->buffer);
+  free(frame);
+}
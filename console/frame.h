@@ -0,0 +1,54 @@
+/**
+ * @file frame.h
+ * @brief Header file for the buffered terminal renderer, which only redraws
+ * the characters that changed since the previous frame
+ */
+
+#pragma once
+
+#include <board.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Key of a character that is not known to be on the screen */
+#define F_UNKNOWN (0xFFFF)
+
+/** Longest run of unchanged characters redrawn instead of moving the cursor */
+#define F_GAP (3)
+
+/** Number of shades of a dot, from dead to every cell alive */
+#define F_LEVELS (6)
+
+/** Ways of drawing cells with characters */
+typedef enum {
+  F_BLOCK,  /**< One dot per two spaces with a background colour */
+  F_HALF,   /**< Two dots per upper half block with both colours */
+  F_BRAILLE /**< Eight dots per braille pattern */
+} RenderMode;
+
+/** State of the screen between two frames */
+typedef struct {
+  int height;       /**< Number of rows of characters drawn */
+  int width;        /**< Number of characters drawn per row */
+  int top;          /**< Terminal row of the first row of characters */
+  RenderMode mode;  /**< How dots are drawn */
+  int row;          /**< Row of the board at the top of the view */
+  int col;          /**< Column of the board at the left of the view */
+  int zoom;         /**< Side of the square of cells shaded into one dot */
+  int stale;        /**< Clears the screen before the next frame */
+  uint16_t *shown;  /**< Key of every character on the screen */
+  char *buffer;     /**< Escape sequences of the frame being built */
+  size_t length;    /**< Number of bytes in the buffer */
+  size_t capacity;  /**< Number of bytes allocated for the buffer */
+} Frame;
+
+Frame *F_new(int height, int width, int top);
+void F_resize(Frame *frame, int height, int width);
+void F_set_mode(Frame *frame, RenderMode mode);
+void F_set_view(Frame *frame, int row, int col, int zoom);
+int F_dots_high(Frame *frame);
+int F_dots_wide(Frame *frame);
+void F_invalidate(Frame *frame);
+size_t F_build(Frame *frame, Board *board, const char *status);
+size_t F_render(Frame *frame, Board *board, const char *status);
+void F_destroy(Frame *frame);
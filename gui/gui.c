@@ -7,51 +7,352 @@
 #include <assert.h>
 #include <board.h>
 #include <gui.h>
-#include <unistd.h>
+#include <pthread.h>
+#include <sparse.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <texture.h>
+#include <triple.h>
 
-#define GLOBAL_HEIGHT 500
-#define GLOBAL_WIDTH 500
+/** Largest side of the window when it opens, in pixels */
+#define GUI_WINDOW 800
 
-#define COLOR_ALIVE 0, 0, 0, 255
-#define COLOR_DEAD 255, 255, 0, 255
+/** Largest side of the texture, bigger boards are downsampled into it */
+#define GUI_TEXTURE 4096
 
-void gui_display(Board *board) {
+/** Largest zoom in pixels per texel, and texels per pixel */
+#define GUI_ZOOM_MAX 64.0f
+
+/** Pixels moved by a pan key */
+#define GUI_PAN 32
+
+/** Generation handed from the simulation thread to the window */
+typedef struct {
+  unsigned long long generation; /**< Number of steps since the start */
+  unsigned char cells[];         /**< 1 for an alive cell, row after row */
+} Snapshot;
+
+/** State shared by the window and the simulation thread */
+typedef struct {
+  Board *board;         /**< Board stepped, only used by the simulation */
+  ThreadPool *pool;     /**< Threads stepping the board */
+  SparseBoard *plane;   /**< Plane of an UNBOUNDED board, NULL otherwise */
+  TripleBuffer *frames; /**< Snapshots of the latest generations */
+  atomic_int quit;      /**< Set by the window to stop the simulation */
+  atomic_int paused;    /**< Set while the simulation is paused */
+  _Atomic double rate;  /**< Target generations per second, 0 unthrottled */
+} Simulation;
+
+/** Part of the texture shown in the window */
+typedef struct {
+  float zoom; /**< Pixels per texel */
+  float x;    /**< Window abscissa of the left of the texture */
+  float y;    /**< Window ordinate of the top of the texture */
+} View;
+
+/**
+ * Returns a monotonic time stamp
+ * @return Time in seconds
+ */
+static double _now(void) {
+  return (double)SDL_GetPerformanceCounter() / SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Copies the cells of the board into a snapshot
+ * @param board Pointer to the board
+ * @param snapshot Pointer to the snapshot
+ * @param generation Number of steps since the start
+ */
+static void _snapshot(Board *board, Snapshot *snapshot,
+                      unsigned long long generation) {
+  unsigned char *cells = snapshot->cells;
+  for (int i = 0; i < board->height; i++, cells += board->width)
+    for (int j = 0; j < board->width; j++)
+      cells[j] = board->cell[i][j] == ALIVE;
+  snapshot->generation = generation;
+}
+
+/**
+ * Steps the board on its own thread and publishes every generation, at the
+ * target rate or as fast as possible
+ * @param arg Pointer to the Simulation
+ * @return NULL
+ */
+static void *_simulate(void *arg) {
+  Simulation *sim = (Simulation *)arg;
+  unsigned long long generation = 0;
+  double next = _now();
+
+  while (!atomic_load(&sim->quit)) {
+    double rate = atomic_load(&sim->rate);
+    double wait = next - _now();
+    if (atomic_load(&sim->paused) || (rate > 0 && wait > 0.001)) {
+      // Short sleeps keep the thread responsive to the keys
+      SDL_Delay(atomic_load(&sim->paused) || wait > 0.01 ? 10
+                                                         : (Uint32)(wait * 1000));
+      if (atomic_load(&sim->paused))
+        next = _now();
+      continue;
+    }
+
+    if (sim->plane != NULL)
+      SB_to_board(SB_step(sim->plane), sim->board, 0, 0);
+    else
+      B_step_parallel(sim->board, sim->pool);
+    _snapshot(sim->board, (Snapshot *)TB_back(sim->frames), ++generation);
+    TB_publish(sim->frames);
+
+    // A slow step delays the next one instead of causing a burst
+    next = rate > 0 ? next + 1 / rate : _now();
+    if (next < _now())
+      next = _now();
+  }
+  return NULL;
+}
+
+/**
+ * Fits the whole texture in the middle of the window
+ * @param view Pointer to the view
+ * @param renderer The renderer of the window
+ * @param width Width of the texture
+ * @param height Height of the texture
+ */
+static void _fit_view(View *view, SDL_Renderer *renderer, int width,
+                      int height) {
+  int w, h;
+  SDL_GetRendererOutputSize(renderer, &w, &h);
+  view->zoom = (float)w / width < (float)h / height ? (float)w / width
+                                                    : (float)h / height;
+  view->x = (w - width * view->zoom) / 2;
+  view->y = (h - height * view->zoom) / 2;
+}
+
+/**
+ * Zooms the view keeping the given point of the window in place
+ * @param view Pointer to the view
+ * @param factor Factor of the zoom
+ * @param x Abscissa of the fixed point in the window
+ * @param y Ordinate of the fixed point in the window
+ */
+static void _zoom_view(View *view, float factor, float x, float y) {
+  float zoom = view->zoom * factor;
+  if (zoom > GUI_ZOOM_MAX)
+    zoom = GUI_ZOOM_MAX;
+  if (zoom < 1 / GUI_ZOOM_MAX)
+    zoom = 1 / GUI_ZOOM_MAX;
+  view->x = x - (x - view->x) * zoom / view->zoom;
+  view->y = y - (y - view->y) * zoom / view->zoom;
+  view->zoom = zoom;
+}
+
+/**
+ * Shows the generation and the speed of the simulation in the title
+ * @param window The window
+ * @param snapshot Latest snapshot
+ * @param measured Measured generations per second
+ * @param sim Pointer to the simulation
+ */
+static void _set_title(SDL_Window *window, Snapshot *snapshot, double measured,
+                       Simulation *sim) {
+  char title[128];
+  double rate = atomic_load(&sim->rate);
+  int n = snprintf(title, sizeof(title),
+                   "Game of Life - generation %llu, %.1f gen/s",
+                   snapshot->generation, measured);
+  if (atomic_load(&sim->paused))
+    snprintf(title + n, sizeof(title) - n, " (paused)");
+  else if (rate > 0)
+    snprintf(title + n, sizeof(title) - n, " (target %g)", rate);
+  else
+    snprintf(title + n, sizeof(title) - n, " (unthrottled)");
+  SDL_SetWindowTitle(window, title);
+}
+
+/**
+ * Displays the board in a window. The board is stepped on its own thread,
+ * which publishes every generation through a triple buffer, and the window
+ * always draws the latest one: its cells are written into a streaming
+ * texture scaled to the window by the renderer. The mouse wheel or + and -
+ * zoom, dragging or the arrows pan, 0 fits the board in the window, f and s
+ * double and halve the target rate, u toggles unthrottled stepping, space
+ * pauses and q or Escape quits. An UNBOUNDED board shows the window at the
+ * origin of an infinite plane. The board is destroyed when the window is
+ * closed, as ansi_display does.
+ * @param board pointer to Board structure
+ * @param plane Plane of an UNBOUNDED board holding cells out of the board,
+ * destroyed with it. NULL to make it from the board.
+ * @param pool Pointer to the thread pool stepping the board, NULL for one
+ * thread
+ * @param rate Target generations per second, 0 for as fast as possible
+ */
+void gui_display(Board *board, SparseBoard *plane, ThreadPool *pool,
+                 double rate) {
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+    printf("gui_display: %s\nExiting...\n", SDL_GetError());
+    exit(1);
+  }
+
+  // Cells are square, as big as the largest side of the board allows
+  int side = board->height > board->width ? board->height : board->width;
+  int cell = side < GUI_WINDOW ? GUI_WINDOW / side : 1;
+  int stride = (side + GUI_TEXTURE - 1) / GUI_TEXTURE;
+  int width = (board->width + stride - 1) / stride;
+  int height = (board->height + stride - 1) / stride;
 
-  SDL_Event event;
   SDL_Window *window = SDL_CreateWindow(
       "Game of Life", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-      GLOBAL_HEIGHT, GLOBAL_WIDTH, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
-
+      board->width * cell < GUI_WINDOW ? board->width * cell : GUI_WINDOW,
+      board->height * cell < GUI_WINDOW ? board->height * cell : GUI_WINDOW,
+      SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE);
   SDL_Renderer *renderer = SDL_CreateRenderer(
       window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
   assert(renderer != NULL);
+  // Cells stay sharp squares when scaled
+  SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+  SDL_Texture *texture =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_STREAMING, width, height);
+  assert(texture != NULL);
+
+  // The first snapshot is published before the simulation starts
+  Simulation sim;
+  sim.board = board;
+  sim.pool = pool;
+  // An UNBOUNDED board shows the window at the origin of an infinite plane
+  sim.plane = plane == NULL && board->version == UNBOUNDED
+                  ? SB_from_board(board, 0, 0)
+                  : plane;
+  sim.frames =
+      TB_new(sizeof(Snapshot) + (size_t)board->height * board->width);
+  atomic_init(&sim.quit, 0);
+  atomic_init(&sim.paused, 0);
+  atomic_init(&sim.rate, rate);
+  _snapshot(board, (Snapshot *)TB_back(sim.frames), 0);
+  TB_publish(sim.frames);
+  pthread_t simulation;
+  if (pthread_create(&simulation, NULL, _simulate, &sim) != 0) {
+    printf("gui_display: Could not start the simulation\nExiting...\n");
+    exit(1);
+  }
+
+  View view;
+  _fit_view(&view, renderer, width, height);
+  SDL_Event event;
+  double last = rate > 0 ? rate : 1, title = 0;
+  unsigned long long shown = 0;
   int quit = 0;
   while (!quit) {
-    for (int i = 0; i < board->height; i++) {
-      for (int j = 0; j < board->width; j++) {
-        // set cell color depending on its status
-        if (B_is_alive(board->cell[i][j]))
-          SDL_SetRenderDrawColor(renderer, COLOR_ALIVE);
-        else
-          SDL_SetRenderDrawColor(renderer, COLOR_DEAD);
-        // create rectangle representing cell
-        SDL_Rect rect = {
-            GLOBAL_HEIGHT / board->height * i, GLOBAL_WIDTH / board->width * j,
-            GLOBAL_HEIGHT / board->height, GLOBAL_WIDTH / board->width};
-        SDL_RenderFillRect(renderer, &rect);
-      }
+    int fresh;
+    Snapshot *snapshot = (Snapshot *)TB_acquire(sim.frames, &fresh);
+    void *pixels;
+    int pitch;
+    if (fresh && SDL_LockTexture(texture, NULL, &pixels, &pitch) == 0) {
+      int timed = board->stats != NULL && board->stats->timing;
+      double drawn = timed ? ST_now() : 0;
+      TX_fill(snapshot->cells, board->height, board->width, pixels, pitch,
+              stride);
+      SDL_UnlockTexture(texture);
+      if (timed)
+        ST_time(board->stats, ST_RENDER, ST_now() - drawn);
     }
+    SDL_Rect rect = {(int)view.x, (int)view.y, (int)(width * view.zoom),
+                     (int)(height * view.zoom)};
+    SDL_SetRenderDrawColor(renderer, 64, 64, 64, 255);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, &rect);
+    // Waits for the vertical sync
     SDL_RenderPresent(renderer);
-    board = B_update(board);
-    sleep(1);
+
+    // The title shows the speed measured over half a second
+    if (_now() - title >= 0.5) {
+      double measured = title > 0 ? (snapshot->generation - shown) /
+                                        (_now() - title)
+                                  : 0;
+      _set_title(window, snapshot, measured, &sim);
+      shown = snapshot->generation;
+      title = _now();
+    }
+    if (!fresh)
+      SDL_Delay(1);
+
     while (!quit && SDL_PollEvent(&event)) {
+      int w, h;
+      SDL_GetRendererOutputSize(renderer, &w, &h);
       switch (event.type) {
       case SDL_QUIT:
         quit = 1;
         break;
+      case SDL_MOUSEWHEEL:
+        _zoom_view(&view, event.wheel.y > 0 ? 1.25f : 0.8f, w / 2.0f,
+                   h / 2.0f);
+        break;
+      case SDL_MOUSEMOTION:
+        if (event.motion.state & SDL_BUTTON_LMASK) {
+          view.x += event.motion.xrel;
+          view.y += event.motion.yrel;
+        }
+        break;
+      case SDL_KEYDOWN:
+        switch (event.key.keysym.sym) {
+        case SDLK_q:
+        case SDLK_ESCAPE:
+          quit = 1;
+          break;
+        case SDLK_PLUS:
+        case SDLK_EQUALS:
+        case SDLK_KP_PLUS:
+          _zoom_view(&view, 2, w / 2.0f, h / 2.0f);
+          break;
+        case SDLK_MINUS:
+        case SDLK_KP_MINUS:
+          _zoom_view(&view, 0.5f, w / 2.0f, h / 2.0f);
+          break;
+        case SDLK_0:
+          _fit_view(&view, renderer, width, height);
+          break;
+        case SDLK_UP:
+          view.y += GUI_PAN;
+          break;
+        case SDLK_DOWN:
+          view.y -= GUI_PAN;
+          break;
+        case SDLK_LEFT:
+          view.x += GUI_PAN;
+          break;
+        case SDLK_RIGHT:
+          view.x -= GUI_PAN;
+          break;
+        case SDLK_f:
+          if (atomic_load(&sim.rate) > 0)
+            atomic_store(&sim.rate, last = atomic_load(&sim.rate) * 2);
+          break;
+        case SDLK_s:
+          if (atomic_load(&sim.rate) > 0)
+            atomic_store(&sim.rate, last = atomic_load(&sim.rate) / 2);
+          break;
+        case SDLK_u:
+          atomic_store(&sim.rate, atomic_load(&sim.rate) > 0 ? 0 : last);
+          break;
+        case SDLK_SPACE:
+          atomic_store(&sim.paused, !atomic_load(&sim.paused));
+          break;
+        }
+        break;
       }
     }
   }
+
+  atomic_store(&sim.quit, 1);
+  pthread_join(simulation, NULL);
+  if (sim.plane != NULL)
+    SB_destroy(sim.plane);
+  TB_destroy(sim.frames);
+  B_destroy(board);
+  SDL_DestroyTexture(texture);
+  SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
 }
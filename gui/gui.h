@@ -5,7 +5,9 @@
 #ifndef GUI_H
 #define GUI_H
 #include<board.h>
+#include<sparse.h>
 
-void gui_display(Board *board);
+void gui_display(Board *board, SparseBoard *plane, ThreadPool *pool,
+                 double rate);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+/**
+ * @file texture.c
+ * @brief Contains the drawing of the cells of a board into the pixels of the
+ * window texture, downsampling boards larger than the texture
+ */
+#include <stddef.h>
+#include <texture.h>
+
+/**
+ * Writes the cells of a snapshot into the pixels of the texture. With a
+ * stride above 1 a texel is a square of stride x stride cells, alive if any
+ * of them is.
+ * @param cells Cells of the snapshot, 1 for alive
+ * @param height Number of rows of cells
+ * @param width Number of columns of cells
+ * @param pixels Locked pixels of the texture
+ * @param pitch Number of bytes of a row of pixels
+ * @param stride Side of the square of cells of a texel
+ */
+void TX_fill(const unsigned char *cells, int height, int width, void *pixels,
+             int pitch, int stride) {
+  static const uint32_t colors[2] = {COLOR_DEAD, COLOR_ALIVE};
+
+  if (stride == 1) {
+    for (int i = 0; i < height; i++, cells += width) {
+      uint32_t *row = (uint32_t *)((uint8_t *)pixels + (size_t)i * pitch);
+      for (int j = 0; j < width; j++)
+        row[j] = colors[cells[j]];
+    }
+    return;
+  }
+
+  for (int i = 0; i * stride < height; i++) {
+    uint32_t *row = (uint32_t *)((uint8_t *)pixels + (size_t)i * pitch);
+    int bottom = (i + 1) * stride < height ? (i + 1) * stride : height;
+    for (int j = 0; j * stride < width; j++) {
+      int right = (j + 1) * stride < width ? (j + 1) * stride : width;
+      int alive = 0;
+      for (int r = i * stride; r < bottom && !alive; r++)
+        for (int c = j * stride; c < right && !alive; c++)
+          alive = cells[(size_t)r * width + c];
+      row[j] = colors[alive];
+    }
+  }
+}
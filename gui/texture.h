@@ -0,0 +1,18 @@
+/**
+ * @file texture.h
+ * @brief Header file for the drawing of the cells of a board into the pixels
+ * of the window texture, kept apart from SDL so it can be tested headless
+ */
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <stdint.h>
+
+/** Colour of an alive cell, ARGB8888 */
+#define COLOR_ALIVE 0xFF000000u
+/** Colour of a dead cell, ARGB8888 */
+#define COLOR_DEAD 0xFFFFFF00u
+
+void TX_fill(const unsigned char *cells, int height, int width, void *pixels,
+             int pitch, int stride);
+#endif
@@ -6,6 +6,16 @@
 #include "board.h"
 #include "gui.h"
 #include <ansi.h>
+#include <batch.h>
+#include <cycle.h>
+#include <distributed.h>
+#include <frame.h>
+#include <hashlife.h>
+#include <packed.h>
+#include <pattern.h>
+#include <snapshot.h>
+#include <sparse.h>
+#include <stats.h>
 //#include <bits/getopt_core.h>
 #include <getopt.h>
 #include <board.h>
@@ -13,6 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <time.h>
 #include <unistd.h>
 #define BOARD_WIDTH_TERM (10) /**< The default width of the board in           \
                                  terminal*/
@@ -27,105 +40,1020 @@
  */
 typedef enum {
   TERM, /**< The terminal typ */
-  GUI   /**< The gui type */
+  GUI,  /**< The gui type */
+  BENCH, /**< The headless benchmark type */
+  BATCH  /**< Many small boards run to stabilization */
 } Type;
 
-void ansi_display(Board *board);
+/**
+ * Engines that can step the board in the benchmark.
+ */
+typedef enum {
+  ENGINE_BOARD,   /**< B_step_parallel on the byte per cell board */
+  ENGINE_TILES,   /**< The same with activity tracking of the tiles */
+  ENGINE_PACKED,  /**< PB_step on the bit-packed board */
+  ENGINE_SPARSE,  /**< SB_step on the unbounded sparse board */
+  ENGINE_HASHLIFE, /**< HL_advance on the HashLife universe */
+  ENGINE_DISTRIBUTED, /**< DS_step on worker processes, one per thread */
+  ENGINE_BLOCKED /**< B_step_n, several generations per pass over memory */
+} Engine;
+
+/**
+ * Formats of the benchmark report.
+ */
+typedef enum {
+  FORMAT_TEXT, /**< Human readable lines */
+  FORMAT_CSV,  /**< A header line and a line of values */
+  FORMAT_JSON  /**< One JSON object on a line */
+} Format;
+
+/** Names of the versions, in the order of Version */
+static const char *version_names[] = {"clipped", "circular", "unbounded"};
+
+/** Names of the engines, in the order of Engine */
+static const char *engine_names[] = {"board",    "tiles",       "packed",
+                                     "sparse",   "hashlife",    "distributed",
+                                     "blocked"};
+
+/** Names of the report formats, in the order of Format */
+static const char *format_names[] = {"text", "csv", "json"};
+
+/** Names of the terminal rendering modes, in the order of RenderMode */
+static const char *render_names[] = {"block", "half", "braille"};
+
+/** Everything the command line can configure */
+typedef struct {
+  Type type;         /**< Type of the game */
+  Version version;   /**< Rules of the board */
+  int threads;       /**< Number of threads stepping the board */
+  int height;        /**< Height of the board, 0 for the type default */
+  int width;         /**< Width of the board, 0 for the type default */
+  int density;       /**< Probability in percent of a cell being alive */
+  unsigned long long seed; /**< Seed of the random board */
+  long generations;  /**< Number of generations of the benchmark */
+  Engine engine;     /**< Engine of the benchmark */
+  Format format;     /**< Format of the benchmark report */
+  RenderMode render; /**< How the terminal draws the cells */
+  int zoom;          /**< Side of the square of cells of a terminal dot */
+  double rate;       /**< Generations per second shown, 0 unthrottled */
+  int cycles;        /**< Stop once the board is in a cycle */
+  long checkpoint;   /**< Generations between two snapshots, 0 for none */
+  const char *snapshot; /**< Path of the snapshots of the checkpoints */
+  const char *resume;   /**< Snapshot the board is loaded from, or NULL */
+  const char *pattern;  /**< Pattern the board starts from, or NULL */
+  int placed;           /**< Set when the pattern offset was given */
+  long long row;        /**< Row of the top left cell of the pattern */
+  long long col;        /**< Column of the top left cell of the pattern */
+  const char *output;   /**< Pattern file the final board is written to */
+  const Rule *rule;     /**< Rule of the board, NULL for B3/S23 */
+  long long boards;     /**< Number of boards of a batch */
+  const char *stats;    /**< File the statistics of every generation are
+                           written to, or NULL */
+  int timing;           /**< Set to also time the phases of the steps */
+} Options;
+
+void ansi_display(Board *board, SparseBoard *plane, ThreadPool *pool,
+                  Options *options);
+int bench_run(Options *options);
+int batch_run(Options *options);
 void usageError(char *progName);
+
+/**
+ * Finds the given name in a list of names
+ * @param names List of names
+ * @param count Number of names
+ * @param name Name to look for
+ * @return Index of the name, -1 if it is not in the list
+ */
+static int find_name(const char **names, int count, const char *name) {
+  for (int k = 0; k < count; k++)
+    if (strcmp(names[k], name) == 0)
+      return k;
+  return -1;
+}
+
+/**
+ * Prints an error for a wrong option value listing the accepted ones
+ * @param opt The option
+ * @param names The accepted values
+ * @param count Number of accepted values
+ */
+static void wrong_value(int opt, const char **names, int count) {
+  fprintf(stderr, "Wrong option value for %c. Use", opt);
+  for (int k = 0; k < count; k++)
+    fprintf(stderr, "%s %s", k == 0 ? "" : k == count - 1 ? " or" : ",",
+            names[k]);
+  fprintf(stderr, ".\n");
+}
+
+/**
+ * Loads the board of a snapshot, terminating the execution if it cannot
+ * @param path Path of the snapshot
+ * @param generation Receives the number of the generation saved, may be NULL
+ * @return Pointer to the loaded board
+ */
+static Board *load_snapshot(const char *path, uint64_t *generation) {
+  Board *board = SN_load(path, generation);
+  if (board == NULL) {
+    printf("Exiting...\n");
+    exit(1);
+  }
+  return board;
+}
+
+/**
+ * Finds where a pattern is placed: at the offset of the options if given,
+ * else centred on the board
+ * @param options Pointer to the command line options
+ * @param height Height of the board
+ * @param width Width of the board
+ * @param row Receives the row of the top left cell of the pattern
+ * @param col Receives the column of the top left cell of the pattern
+ */
+static void place_pattern(Options *options, int height, int width,
+                          int64_t *row, int64_t *col) {
+  int64_t top, left, rows, cols;
+  if (options->placed) {
+    *row = options->row;
+    *col = options->col;
+    return;
+  }
+  if (PT_bounds(options->pattern, &top, &left, &rows, &cols) != 0) {
+    printf("Exiting...\n");
+    exit(1);
+  }
+  *row = (height - rows) / 2 - top;
+  *col = (width - cols) / 2 - left;
+}
+
+/**
+ * Opens the statistics file of the options, its format given by its
+ * extension: CSV for .csv, JSON lines otherwise. "-" is the standard output,
+ * in JSON lines. Phases are only timed with -U, their columns being 0
+ * otherwise.
+ * @param options Pointer to the command line options
+ * @return Pointer to the collector, NULL if no statistics are asked for
+ */
+static StatsCollector *open_stats(Options *options) {
+  if (options->stats == NULL)
+    return NULL;
+  if (strcmp(options->stats, "-") == 0)
+    return ST_new(stdout, ST_JSONL, options->timing);
+  const char *dot = strrchr(options->stats, '.');
+  FILE *file = fopen(options->stats, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open %s for the statistics.\n", options->stats);
+    exit(EXIT_FAILURE);
+  }
+  return ST_new(file, dot != NULL && strcmp(dot, ".csv") == 0 ? ST_CSV
+                                                               : ST_JSONL,
+                options->timing);
+}
+
+/**
+ * Writes the last generation and closes the statistics file
+ * @param stats Pointer to the collector
+ * @param options Pointer to the command line options
+ */
+static void close_stats(StatsCollector *stats, Options *options) {
+  FILE *file = stats->file;
+  ST_destroy(stats);
+  if (strcmp(options->stats, "-") != 0)
+    fclose(file);
+}
+
+/**
+ * Gives the board the rule of the options, terminating the execution if the
+ * engine or the version of the board cannot step it
+ * @param board Pointer to the struct Board
+ * @param options Pointer to the command line options
+ * @return Pointer to the board
+ */
+static Board *apply_rule(Board *board, Options *options) {
+  const Rule *rule = options->rule;
+  if (rule == NULL)
+    return board;
+  // The sparse plane and HashLife only know B3/S23
+  int life = options->type == BENCH ? options->engine != ENGINE_SPARSE &&
+                                          options->engine != ENGINE_HASHLIFE
+                                    : board->version != UNBOUNDED;
+  if (!RU_is_life(rule) && !life) {
+    fprintf(stderr, "Rules other than B3/S23 need the board, tiles or packed "
+                    "engine and a bounded board.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (rule->states > 2 && options->type == BENCH &&
+      options->engine == ENGINE_PACKED) {
+    fprintf(stderr, "Generations rules need the board or tiles engine.\n");
+    exit(EXIT_FAILURE);
+  }
+  return B_set_rule(board, rule);
+}
+
+/**
+ * Fills a new board with the pattern of the options, or else with random
+ * cells. An UNBOUNDED pattern is loaded whole into a plane, the board only
+ * showing the window at its origin.
+ * @param board Pointer to the struct Board, all its cells dead
+ * @param options Pointer to the command line options
+ * @param pool Thread pool generating the random cells, may be NULL
+ * @param plane Receives the plane of an UNBOUNDED pattern, NULL otherwise
+ * @return Pointer to the board
+ */
+static Board *start_board(Board *board, Options *options, ThreadPool *pool,
+                          SparseBoard **plane) {
+  int64_t row, col;
+  *plane = NULL;
+  if (options->pattern == NULL)
+    return B_generate_parallel(board, options->density, options->seed, pool);
+  place_pattern(options, board->height, board->width, &row, &col);
+  if (board->version == UNBOUNDED) {
+    *plane = SB_new();
+    if (PT_load_sparse(options->pattern, *plane, row, col) != 0) {
+      printf("Exiting...\n");
+      exit(1);
+    }
+    return SB_to_board(*plane, board, 0, 0);
+  }
+  if (PT_load(options->pattern, board, row, col) != 0) {
+    printf("Exiting...\n");
+    exit(1);
+  }
+  return board;
+}
+
 int main(int argc, char **argv) {
-  int opt;
+  int opt, k;
   int vflag = 0;
-  Version v;
-  // set terminal type by default
-  Type type = TERM;
+  Rule rule;
+  Options options = {TERM, CLIPPED, 1, 0, 0, 33, (unsigned int)time(NULL),
+                     1000, ENGINE_BOARD, FORMAT_TEXT, F_BLOCK, 1, 1, 0, 0, "gol.snap", NULL,
+                     NULL, 0, 0, 0, NULL, NULL, 1000, NULL, 0};
+  const char *types[] = {"terminal", "gui", "bench", "batch"};
+  struct option long_options[] = {
+      {"version", required_argument, NULL, 'v'},
+      {"type", required_argument, NULL, 't'},
+      {"threads", required_argument, NULL, 'j'},
+      {"size", required_argument, NULL, 's'},
+      {"density", required_argument, NULL, 'd'},
+      {"seed", required_argument, NULL, 'S'},
+      {"generations", required_argument, NULL, 'g'},
+      {"engine", required_argument, NULL, 'e'},
+      {"format", required_argument, NULL, 'o'},
+      {"render", required_argument, NULL, 'r'},
+      {"zoom", required_argument, NULL, 'z'},
+      {"rate", required_argument, NULL, 'R'},
+      {"cycles", no_argument, NULL, 'c'},
+      {"checkpoint", required_argument, NULL, 'C'},
+      {"snapshot", required_argument, NULL, 'F'},
+      {"resume", required_argument, NULL, 'L'},
+      {"pattern", required_argument, NULL, 'P'},
+      {"at", required_argument, NULL, 'A'},
+      {"export", required_argument, NULL, 'W'},
+      {"rule", required_argument, NULL, 'l'},
+      {"boards", required_argument, NULL, 'n'},
+      {"stats", required_argument, NULL, 'T'},
+      {"timing", no_argument, NULL, 'U'},
+      {NULL, 0, NULL, 0}};
 
-  char *version_names[2] = {"circular", "clipped"};
   // if no arguments are given
   if (argc == 1)
     usageError(argv[0]);
 
-  // check for -v
-  while ((opt = getopt(argc, argv, "v:t:")) != -1) {
+  while ((opt = getopt_long(argc, argv, "v:t:j:s:d:S:g:e:o:r:z:R:cC:F:L:P:A:W:l:n:T:U", long_options,
+                            NULL)) != -1) {
     switch (opt) {
     case 'v':
-      // Set version to circular
-      if (strcmp(version_names[0], optarg) == 0 &&
-          strlen(optarg) == strlen(version_names[0])) {
-        v = CIRCULAR;
+      if ((k = find_name(version_names, 3, optarg)) >= 0) {
+        options.version = (Version)k;
         vflag = 1;
+      } else
+        wrong_value(opt, version_names, 3);
+      break;
+    case 't':
+      if ((k = find_name(types, 4, optarg)) >= 0)
+        options.type = (Type)k;
+      else
+        wrong_value(opt, types, 4);
+      break;
+    case 'j':
+      options.threads = atoi(optarg);
+      if (options.threads < 1) {
+        fprintf(stderr, "Wrong option value for %c. Use a positive number.\n",
+                opt);
+        options.threads = 1;
       }
-      // Set version to clipped
-      else if (strcmp(version_names[1], optarg) == 0 &&
-               strlen(optarg) == strlen(version_names[1])) {
-        v = CLIPPED;
-        vflag = 1;
+      break;
+    case 's':
+      // Either HEIGHTxWIDTH or a single side of a square
+      if (sscanf(optarg, "%dx%d", &options.height, &options.width) == 1)
+        options.width = options.height;
+      if (options.height < 1 || options.width < 1) {
+        fprintf(stderr, "Wrong option value for %c. Use HEIGHTxWIDTH.\n", opt);
+        usageError(argv[0]);
+      }
+      break;
+    case 'd':
+      options.density = atoi(optarg);
+      if (options.density < 0 || options.density > 100) {
+        fprintf(stderr, "Wrong option value for %c. Use 0 to 100.\n", opt);
+        usageError(argv[0]);
       }
-      // Print error message
+      break;
+    case 'S':
+      options.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'g':
+      options.generations = atol(optarg);
+      break;
+    case 'e':
+      if ((k = find_name(engine_names, 7, optarg)) >= 0)
+        options.engine = (Engine)k;
       else
-        fprintf(stderr, "Wrong option value for %c. Use either %s or %s.\n",
-                opt, version_names[0], version_names[1]);
+        wrong_value(opt, engine_names, 7);
       break;
-    case 't':
-      if (strcmp("gui", optarg) == 0 && strlen(optarg) == strlen("gui")) {
-        type = GUI;
-      } else if (strcmp("terminal", optarg) == 0 &&
-                 strlen(optarg) == strlen("terminal")) {
-        type = TERM;
-      } else
-        fprintf(stderr, "Wrong option value for %c. Use either %s or %s.\n",
-                opt, "terminal", "gui");
+    case 'o':
+      if ((k = find_name(format_names, 3, optarg)) >= 0)
+        options.format = (Format)k;
+      else
+        wrong_value(opt, format_names, 3);
+      break;
+    case 'r':
+      if ((k = find_name(render_names, 3, optarg)) >= 0)
+        options.render = (RenderMode)k;
+      else
+        wrong_value(opt, render_names, 3);
+      break;
+    case 'z':
+      options.zoom = atoi(optarg);
+      if (options.zoom < 1) {
+        fprintf(stderr, "Wrong option value for %c. Use a positive number.\n",
+                opt);
+        options.zoom = 1;
+      }
+      break;
+    case 'R':
+      // Either a number of generations per second or unthrottled
+      options.rate = strcmp(optarg, "unthrottled") == 0 ? 0 : atof(optarg);
+      if (options.rate < 0 || (options.rate == 0 &&
+                               strcmp(optarg, "unthrottled") != 0)) {
+        fprintf(stderr, "Wrong option value for %c. Use a positive number or "
+                        "unthrottled.\n",
+                opt);
+        options.rate = 1;
+      }
+      break;
+    case 'c':
+      options.cycles = 1;
+      break;
+    case 'C':
+      options.checkpoint = atol(optarg);
+      if (options.checkpoint < 0) {
+        fprintf(stderr, "Wrong option value for %c. Use a positive number.\n",
+                opt);
+        options.checkpoint = 0;
+      }
+      break;
+    case 'F':
+      options.snapshot = optarg;
+      break;
+    case 'L':
+      options.resume = optarg;
+      break;
+    case 'P':
+      options.pattern = optarg;
+      break;
+    case 'A':
+      if (sscanf(optarg, "%lld,%lld", &options.row, &options.col) != 2) {
+        fprintf(stderr,
+                "Wrong option value for %c. Use <row>,<column>.\n", opt);
+        usageError(argv[0]);
+      }
+      options.placed = 1;
+      break;
+    case 'W':
+      options.output = optarg;
+      break;
+    case 'l':
+      if (RU_parse(&rule, optarg) != 0) {
+        fprintf(stderr, "Wrong option value for %c. Use B<digits>/S<digits> "
+                        "with an optional /C<states>.\n",
+                opt);
+        usageError(argv[0]);
+      }
+      options.rule = &rule;
+      break;
+    case 'n':
+      options.boards = atoll(optarg);
+      if (options.boards < 1) {
+        fprintf(stderr, "Wrong option value for %c. Use a positive number.\n",
+                opt);
+        options.boards = 1000;
+      }
+      break;
+    case 'T':
+      options.stats = optarg;
+      break;
+    case 'U':
+      options.timing = 1;
       break;
     default:
       usageError(argv[0]);
       break;
     }
   }
-  // check if -v was not included
-  if (!vflag) {
+  // check if -v was not included, a resumed board has its own version
+  if (!vflag && options.resume == NULL) {
     usageError(argv[0]);
   }
+  // An RLE pattern gives its rule, unless -l was given
+  if (options.rule == NULL && options.pattern != NULL) {
+    int read = PT_rule(options.pattern, &rule);
+    if (read < 0) {
+      fprintf(stderr, "Give the rule of the pattern with -l.\n");
+      exit(EXIT_FAILURE);
+    }
+    if (read > 0)
+      options.rule = &rule;
+  }
+
+  if (options.type == BENCH)
+    return bench_run(&options);
+  if (options.type == BATCH)
+    return batch_run(&options);
 
-  if (type == TERM) {
-    Board *board = B_new(BOARD_HEIGHT_TERM, BOARD_WIDTH_TERM, v);
-    board = B_generate(board, 33);
-    ansi_display(board);
-  } else if(type == GUI){
-    Board *board = B_new(BOARD_HEIGHT_GUI, BOARD_WIDTH_GUI, v);
-    board = B_generate(board, 33);
-    gui_display(board);
+  // Worker threads are only started when more than one is asked for
+  ThreadPool *pool = options.threads > 1 ? TP_new(options.threads) : NULL;
+  Version v = options.version;
+
+  StatsCollector *stats = open_stats(&options);
+  SparseBoard *plane = NULL;
+  if (options.resume != NULL) {
+    Board *board = apply_rule(load_snapshot(options.resume, NULL), &options);
+    B_collect_stats(board, stats);
+    if (options.type == TERM)
+      ansi_display(board, NULL, pool, &options);
+    else
+      gui_display(board, NULL, pool, options.rate);
+  } else if (options.type == TERM) {
+    Board *board = B_new(options.height ? options.height : BOARD_HEIGHT_TERM,
+                         options.width ? options.width : BOARD_WIDTH_TERM, v);
+    // Generate board with 33% probability of cells being alive by default
+    board = start_board(apply_rule(board, &options), &options, pool, &plane);
+    B_collect_stats(board, stats);
+    ansi_display(board, plane, pool, &options);
+  } else if(options.type == GUI){
+    Board *board = B_new(options.height ? options.height : BOARD_HEIGHT_GUI,
+                         options.width ? options.width : BOARD_WIDTH_GUI, v);
+    board = start_board(apply_rule(board, &options), &options, pool, &plane);
+    B_collect_stats(board, stats);
+    gui_display(board, plane, pool, options.rate);
   }
+  if (stats != NULL)
+    close_stats(stats, &options);
+  if (pool != NULL)
+    TP_destroy(pool);
 
-  // Generate board with 33% probability of cells being alive
   return 0;
 }
 
 void usageError(char *progName) {
-  fprintf(stderr, "Usage: %s -v <version>\n", progName);
+  fprintf(stderr,
+          "Usage: %s -v <version> [-t terminal|gui|bench|batch] [-j <threads>]\n"
+          "          [-s <height>x<width>] [-d <density>] [-S <seed>]\n"
+          "          [-g <generations>] [-e <engine>] [-o text|csv|json]\n"
+          "          [-r block|half|braille] [-z <zoom>]\n"
+          "          [-R <generations per second>|unthrottled] [-c]\n"
+          "          [-C <generations> [-F <snapshot>]] [-L <snapshot>]\n"
+          "          [-P <pattern> [-A <row>,<column>]] [-W <pattern>]\n"
+          "          [-l B<digits>/S<digits>[/C<states>]] [-n <boards>]\n"
+          "          [-T <statistics>.csv|<statistics>.jsonl|- [-U]]\n",
+          progName);
   exit(EXIT_FAILURE);
 }
 
+/**
+ * Returns a monotonic time stamp
+ * @return Time in seconds
+ */
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Returns the peak resident set size of the process
+ * @return Peak RSS in kilobytes
+ */
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * Counts the alive cells of the board
+ * @param board pointer to Board structure
+ * @return Population
+ */
+static unsigned long long population(Board *board) {
+  unsigned long long count = 0;
+  for (size_t k = 0; k < (size_t)board->height * board->width; k++)
+    count += B_is_alive(board->cells[k]);
+  return count;
+}
+
+/**
+ * Steps a random board with the chosen engine, without display and without
+ * sleeping, and reports the speed
+ * @param options Pointer to the command line options
+ * @return Exit status of the program
+ */
+int bench_run(Options *options) {
+  int height = options->height ? options->height : 1024;
+  int width = options->width ? options->width : 1024;
+  long generations = options->generations;
+  Board *board = NULL;
+  // The threads of the distributed engine are its worker processes
+  ThreadPool *pool = options->threads > 1 &&
+                             options->engine != ENGINE_DISTRIBUTED
+                         ? TP_new(options->threads)
+                         : NULL;
+  PackedBoard *packed = NULL;
+  Distributed *ds = NULL;
+  SparseBoard *sparse = NULL;
+  HashLife *life = NULL;
+  CycleDetector *detector = NULL;
+  unsigned long long alive = 0;
+  uint64_t first = 0;
+
+  if (options->resume != NULL && options->engine == ENGINE_PACKED) {
+    // The cells are read in place from the mapped snapshot, a board of one
+    // row only keeps the rule
+    packed = SN_load_packed(options->resume, &first);
+    if (packed == NULL) {
+      printf("Exiting...\n");
+      exit(1);
+    }
+    options->version = packed->version;
+    height = packed->height;
+    width = packed->width;
+    board = apply_rule(B_new(1, width, options->version), options);
+  } else if (options->resume != NULL) {
+    board = apply_rule(load_snapshot(options->resume, &first), options);
+    options->version = board->version;
+    height = board->height;
+    width = board->width;
+  } else if (options->pattern != NULL &&
+             options->engine == ENGINE_SPARSE) {
+    // The plane holds the whole pattern, even out of the board
+    int64_t row, col;
+    board = apply_rule(B_new(height, width, options->version), options);
+    place_pattern(options, height, width, &row, &col);
+    sparse = SB_new();
+    if (PT_load_sparse(options->pattern, sparse, row, col) != 0) {
+      printf("Exiting...\n");
+      exit(1);
+    }
+  } else if (options->pattern != NULL) {
+    // These engines only step the board, not the plane around it
+    board = apply_rule(B_new(height, width, options->version), options);
+    board = start_board(board, options, pool, &sparse);
+    if (sparse != NULL) {
+      SB_destroy(sparse);
+      sparse = NULL;
+    }
+    if (options->engine == ENGINE_PACKED)
+      packed = PB_from_board(board);
+  } else if (options->engine == ENGINE_PACKED) {
+    // The packed engine is generated directly, without the byte board: a
+    // board of one row only keeps the rule
+    board = apply_rule(B_new(1, width, options->version), options);
+    packed = PB_generate(PB_new(height, width, options->version),
+                         options->density, options->seed, pool);
+  } else if (options->engine == ENGINE_DISTRIBUTED) {
+    // The workers draw their own rows, the coordinator only keeps the rule
+    board = apply_rule(B_new(1, width, options->version), options);
+  } else {
+    board = apply_rule(B_new(height, width, options->version), options);
+    B_generate_parallel(board, options->density, options->seed, pool);
+  }
+  // Generations are counted from the start of the first run
+  if ((long)first > generations)
+    first = (uint64_t)generations;
+  long stepped = generations - (long)first;
+  if (options->checkpoint > 0 && (options->engine == ENGINE_SPARSE ||
+                                  options->engine == ENGINE_HASHLIFE)) {
+    fprintf(stderr, "Checkpoints need the board, tiles or packed engine.\n");
+    options->checkpoint = 0;
+  }
+  if (options->checkpoint > 0 && board->rule.states > 2) {
+    // Snapshots keep one bit per cell, the dying states would be lost
+    fprintf(stderr, "Checkpoints need a two state rule.\n");
+    options->checkpoint = 0;
+  }
+  if (options->output != NULL && board->rule.states > 2) {
+    // Pattern files only hold alive and dead cells
+    fprintf(stderr, "Exports need a two state rule.\n");
+    options->output = NULL;
+  }
+  if (packed != NULL)
+    PB_set_rule(packed, &board->rule);
+  if (options->engine == ENGINE_DISTRIBUTED) {
+    if (options->version == UNBOUNDED) {
+      fprintf(stderr, "The distributed engine needs a bounded board.\n");
+      exit(EXIT_FAILURE);
+    }
+    ds = DS_new(height, width, options->version, &board->rule,
+                options->threads);
+    ds->generation = first;
+    if (options->resume != NULL || options->pattern != NULL)
+      DS_scatter(ds, board);
+    else
+      DS_generate(ds, options->density, options->seed);
+  }
+
+  if (options->engine == ENGINE_TILES)
+    B_track_activity(board, 1);
+  else if (options->engine == ENGINE_SPARSE && sparse == NULL)
+    sparse = SB_from_board(board, 0, 0);
+  else if (options->engine == ENGINE_HASHLIFE)
+    life = HL_from_board(board);
+  if (options->cycles && (options->engine == ENGINE_BOARD ||
+                          options->engine == ENGINE_TILES))
+    detector = CD_new(board);
+  else if (options->cycles)
+    fprintf(stderr, "Cycle detection needs the board or tiles engine.\n");
+  StatsCollector *stats = NULL;
+  if (options->stats != NULL &&
+      (options->engine == ENGINE_BOARD || options->engine == ENGINE_TILES ||
+       options->engine == ENGINE_BLOCKED))
+    B_collect_stats(board, stats = open_stats(options));
+  else if (options->stats != NULL)
+    fprintf(stderr,
+            "Statistics need the board, tiles or blocked engine.\n");
+
+  double start = now();
+  switch (options->engine) {
+  case ENGINE_BOARD:
+  case ENGINE_TILES:
+    for (long t = (long)first; t < generations; t++) {
+      B_step_parallel(board, pool);
+      if (options->checkpoint > 0 && (t + 1) % options->checkpoint == 0 &&
+          SN_save(options->snapshot, board, (uint64_t)t + 1, 1) != 0)
+        fprintf(stderr, "Checkpoint of generation %ld failed.\n", t + 1);
+      if (detector != NULL && CD_observe(detector, board)) {
+        // The generations left only go around the cycle, at most once
+        long long left = CD_skip(detector, generations - (long)first);
+        for (long long k = 0; k < left; k++)
+          B_step_parallel(board, pool);
+        stepped = t + 1 - (long)first + (long)left;
+        break;
+      }
+    }
+    break;
+  case ENGINE_PACKED:
+    for (long t = (long)first; t < generations; t++) {
+      PB_step(packed);
+      if (options->checkpoint > 0 && (t + 1) % options->checkpoint == 0 &&
+          SN_save_packed(options->snapshot, packed, (uint64_t)t + 1, 1) != 0)
+        fprintf(stderr, "Checkpoint of generation %ld failed.\n", t + 1);
+    }
+    break;
+  case ENGINE_SPARSE:
+    for (long t = (long)first; t < generations; t++)
+      SB_step(sparse);
+    break;
+  case ENGINE_HASHLIFE:
+    HL_advance(life, (uint64_t)(generations - (long)first));
+    break;
+  case ENGINE_DISTRIBUTED:
+  case ENGINE_BLOCKED:
+    // Both engines only stop at the checkpoints
+    for (long t = (long)first; t < generations;) {
+      long n = generations - t;
+      if (options->checkpoint > 0 &&
+          options->checkpoint - t % options->checkpoint < n)
+        n = options->checkpoint - t % options->checkpoint;
+      if (ds != NULL)
+        DS_step(ds, n);
+      else
+        B_step_n(board, n, pool);
+      t += n;
+      if (options->checkpoint > 0 && t % options->checkpoint == 0 &&
+          (ds != NULL ? DS_save(ds, options->snapshot, 1)
+                      : SN_save(options->snapshot, board, (uint64_t)t, 1)) !=
+              0)
+        fprintf(stderr, "Checkpoint of generation %ld failed.\n", t);
+    }
+    break;
+  }
+  double seconds = now() - start;
+
+  if (options->output != NULL) {
+    // The other engines are copied back into the board first
+    if (packed != NULL) {
+      B_destroy(board);
+      board = PB_to_board(
+          packed, apply_rule(B_new(height, width, options->version), options));
+    } else if (sparse != NULL)
+      SB_to_board(sparse, board, 0, 0);
+    else if (life != NULL)
+      HL_to_board(life, board, 0, 0);
+    else if (ds != NULL) {
+      B_destroy(board);
+      board = DS_gather(
+          ds, apply_rule(B_new(height, width, options->version), options));
+    }
+    if (PT_save(options->output, board, PT_UNKNOWN) != 0)
+      fprintf(stderr, "Export of the final board failed.\n");
+  }
+
+  if (packed != NULL) {
+    alive = PB_population(packed);
+    PB_destroy(packed);
+  } else if (sparse != NULL) {
+    alive = SB_population(sparse);
+    SB_destroy(sparse);
+  } else if (life != NULL) {
+    alive = HL_population(life);
+    HL_destroy(life);
+  } else if (ds != NULL) {
+    alive = DS_population(ds);
+    DS_destroy(ds);
+  } else {
+    alive = population(board);
+  }
+
+  // Skipped generations count in the rate but not in the cell updates
+  double rate = seconds > 0 ? (generations - (long)first) / seconds : 0;
+  double cells = seconds > 0 ? stepped / seconds * (double)height * width : 0;
+  long long cycle = detector != NULL ? detector->start : 0;
+  long long period = detector != NULL ? detector->period : 0;
+  long rss = peak_rss_kb();
+  const char *engine = engine_names[options->engine];
+  const char *version = version_names[options->version];
+  char rule[RU_NAME];
+  RU_format(&board->rule, rule, sizeof(rule));
+
+  if (options->format == FORMAT_CSV) {
+    printf("engine,version,height,width,density,seed,threads,generations,"
+           "seconds,generations_per_sec,cell_updates_per_sec,peak_rss_kb,"
+           "population,stepped,cycle_start,period,rule\n");
+    printf("%s,%s,%d,%d,%d,%llu,%d,%ld,%.6f,%.3f,%.0f,%ld,%llu,%ld,%lld,%lld,"
+           "%s\n",
+           engine, version, height, width, options->density, options->seed,
+           options->threads, generations, seconds, rate, cells, rss, alive,
+           stepped, cycle, period, rule);
+  } else if (options->format == FORMAT_JSON) {
+    printf("{\"engine\":\"%s\",\"version\":\"%s\",\"height\":%d,"
+           "\"width\":%d,\"density\":%d,\"seed\":%llu,\"threads\":%d,"
+           "\"generations\":%ld,\"seconds\":%.6f,"
+           "\"generations_per_sec\":%.3f,\"cell_updates_per_sec\":%.0f,"
+           "\"peak_rss_kb\":%ld,\"population\":%llu,\"stepped\":%ld,"
+           "\"cycle_start\":%lld,\"period\":%lld,\"rule\":\"%s\"}\n",
+           engine, version, height, width, options->density, options->seed,
+           options->threads, generations, seconds, rate, cells, rss, alive,
+           stepped, cycle, period, rule);
+  } else {
+    printf("engine %s, version %s, rule %s, %dx%d, density %d%%, seed %llu, "
+           "%d thread(s)\n",
+           engine, version, rule, height, width, options->density,
+           options->seed, options->threads);
+    if (first > 0)
+      printf("resumed at generation %llu\n", (unsigned long long)first);
+    printf("%ld generations in %.3f s\n", generations - (long)first, seconds);
+    printf("%.1f generations/s, %.3g cell updates/s\n", rate, cells);
+    printf("peak RSS %ld kB, final population %llu\n", rss, alive);
+    if (period > 0)
+      printf("stable at generation %lld with period %lld, %ld generations "
+             "stepped\n",
+             cycle, period, stepped);
+  }
+
+  if (detector != NULL)
+    CD_destroy(detector);
+  if (stats != NULL)
+    close_stats(stats, options);
+  if (pool != NULL)
+    TP_destroy(pool);
+  B_destroy(board);
+  return 0;
+}
+
+/**
+ * Writes the result of a board of a batch as a line of CSV or JSON
+ * @param target Pointer to the command line options
+ * @param result Statistics of the board
+ */
+static void print_result(void *target, const BatchResult *result) {
+  Options *options = (Options *)target;
+  if (options->format == FORMAT_JSON)
+    printf("{\"board\":%lld,\"seed\":%llu,\"initial\":%lld,"
+           "\"population\":%lld,\"generations\":%lld,"
+           "\"cycle_start\":%lld,\"period\":%lld}\n",
+           result->index, result->seed, result->initial, result->population,
+           result->generations, result->start, result->period);
+  else
+    printf("%lld,%llu,%lld,%lld,%lld,%lld,%lld\n", result->index,
+           result->seed, result->initial, result->population,
+           result->generations, result->start, result->period);
+}
+
+/**
+ * Runs many small random boards to stabilization and streams one line of
+ * statistics per board, CSV unless JSON lines are asked for. Any board can be
+ * generated again alone from its seed.
+ * @param options Pointer to the command line options
+ * @return Exit status of the program
+ */
+int batch_run(Options *options) {
+  BatchSpec spec;
+  ThreadPool *pool = options->threads > 1 ? TP_new(options->threads) : NULL;
+
+  if (options->version == UNBOUNDED) {
+    fprintf(stderr, "Batches need the clipped or circular version.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (options->stats != NULL)
+    fprintf(stderr, "Batches report one line per board, without "
+                    "statistics per generation.\n");
+  BA_spec(&spec, options->height ? options->height : BOARD_HEIGHT_TERM,
+          options->width ? options->width : BOARD_WIDTH_TERM,
+          options->version, options->density, options->seed,
+          options->generations);
+  if (options->rule != NULL)
+    spec.rule = *options->rule;
+
+  if (options->format != FORMAT_JSON)
+    printf("board,seed,initial,population,generations,cycle_start,period\n");
+  double start = now();
+  BA_run(&spec, options->boards, pool, print_result, options);
+  double seconds = now() - start;
+  fprintf(stderr, "%lld boards of %dx%d in %.3f s, %.1f boards/s\n",
+          options->boards, spec.height, spec.width, seconds,
+          seconds > 0 ? options->boards / seconds : 0);
+
+  if (pool != NULL)
+    TP_destroy(pool);
+  return 0;
+}
+
+/**
+ * Waits for a key on the terminal
+ * @param timeout Longest wait in seconds
+ * @return The key, h, j, k or l for the arrows, or -1 if none was pressed
+ */
+static int read_key(double timeout) {
+  struct timeval tv = {(long)timeout, (long)((timeout - (long)timeout) * 1e6)};
+  fd_set keys;
+  unsigned char buf[8];
+
+  FD_ZERO(&keys);
+  FD_SET(STDIN_FILENO, &keys);
+  if (select(STDIN_FILENO + 1, &keys, NULL, NULL, &tv) <= 0)
+    return -1;
+  ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+  if (n <= 0)
+    return -1;
+  // Arrows are sent as ESC [ A to ESC [ D
+  if (n >= 3 && buf[0] == 0x1b && buf[1] == '[')
+    return buf[2] == 'A' ? 'k' : buf[2] == 'B' ? 'j' : buf[2] == 'C' ? 'l'
+           : buf[2] == 'D' ? 'h' : -1;
+  return buf[0];
+}
+
+/**
+ * Keeps a coordinate of the view inside the board
+ * @param start Coordinate of the first cell of the view
+ * @param view Number of cells of the view
+ * @param size Number of cells of the board
+ * @return The coordinate, between 0 and the last start showing the board
+ */
+static int clamp_view(int start, int view, int size) {
+  if (start > size - view)
+    start = size - view;
+  return start < 0 ? 0 : start;
+}
+
 /** 
- * Displays the board on the terminal
+ * Displays the board on the terminal. An UNBOUNDED board is the window at the
+ * origin of an infinite plane stepped by a SparseBoard. Every frame only
+ * redraws the characters that changed and is written at once. The arrows or
+ * h, j, k and l pan the view, + and - zoom, m changes the mode and q quits.
  * @param board pointer to Board structure
+ * @param plane Plane of an UNBOUNDED board holding cells out of the board,
+ * destroyed with it. NULL to make it from the board.
+ * @param pool Pointer to the thread pool stepping the board, NULL for one
+ * thread
+ * @param options Pointer to the command line options: the mode, zoom and
+ * rate of the display, and whether to stop stepping once the board is in a
+ * cycle
  */
-void ansi_display(Board *board) {
+void ansi_display(Board *board, SparseBoard *plane, ThreadPool *pool,
+                  Options *options) {
+  int zoom = options->zoom;
+  double rate = options->rate;
+  if (board->version == UNBOUNDED && board->stats != NULL)
+    fprintf(stderr, "Statistics need a bounded board.\n");
   setup_console();
 
-  // Generate board with 33% probability of cells being alive
-  board = B_generate(board, 33);
-
-  Board *new_board;
-  int i = 0;
-  while (1) {
-    clean();
-    printf("(t : %d)\n", i++);
-    B_print(board);
-    printf("\n");
-    new_board = B_update(board);
-    B_destroy(board);
-    board = new_board;
-    sleep(1);
-  }
-  B_destroy(new_board);
+  if (plane == NULL && board->version == UNBOUNDED)
+    plane = SB_from_board(board, 0, 0);
+
+  // The status line is on the first row and the board below it
+  Frame *frame = F_new(0, 0, 2);
+  F_set_mode(frame, options->render);
+  CycleDetector *detector =
+      options->cycles && board->version != UNBOUNDED ? CD_new(board) : NULL;
+  char status[128];
+  int t = 0, row = 0, col = 0, running = 1;
+  double tick = now() + (rate > 0 ? 1 / rate : 0);
+  while (running) {
+    // Fit the frame to the terminal, which may have been resized, and to
+    // the part of the board left in the view
+    int rows, cols, high = F_dots_high(frame) * zoom,
+                    wide = F_dots_wide(frame) * zoom;
+    console_size(&rows, &cols);
+    rows -= 2;
+    cols /= frame->mode == F_BLOCK ? 2 : 1;
+    row = clamp_view(row, rows * high, board->height);
+    col = clamp_view(col, cols * wide, board->width);
+    if ((board->height - row + high - 1) / high < rows)
+      rows = (board->height - row + high - 1) / high;
+    if ((board->width - col + wide - 1) / wide < cols)
+      cols = (board->width - col + wide - 1) / wide;
+    if (rows != frame->height || cols != frame->width)
+      F_resize(frame, rows, cols);
+    F_set_view(frame, row, col, zoom);
+
+    int n = snprintf(status, sizeof(status), "(t : %d) %s, zoom %d, view %d,%d",
+                     t, render_names[frame->mode], zoom, row, col);
+    if (detector != NULL && detector->period > 0)
+      snprintf(status + n, sizeof(status) - n,
+               ", stable at %lld with period %lld", detector->start,
+               detector->period);
+    int timed = board->stats != NULL && board->stats->timing;
+    double drawn = timed ? ST_now() : 0;
+    F_render(frame, board, status);
+    if (timed)
+      ST_time(board->stats, ST_RENDER, ST_now() - drawn);
+
+    // Keys only redraw the frame, the board steps at the given rate
+    int stable = detector != NULL && detector->period > 0;
+    switch (read_key(stable ? 1 : tick > now() ? tick - now() : 0)) {
+    case 'q':
+      running = 0;
+      break;
+    case 'k':
+      row -= rows * high / 4 + 1;
+      break;
+    case 'j':
+      row += rows * high / 4 + 1;
+      break;
+    case 'h':
+      col -= cols * wide / 4 + 1;
+      break;
+    case 'l':
+      col += cols * wide / 4 + 1;
+      break;
+    case '+':
+      zoom = zoom > 1 ? zoom / 2 : 1;
+      break;
+    case '-':
+      if (zoom < board->height || zoom < board->width)
+        zoom *= 2;
+      break;
+    case 'm':
+      F_set_mode(frame, (RenderMode)((frame->mode + 1) % 3));
+      break;
+    }
+    // A board in a cycle is not stepped anymore
+    if (now() < tick || stable)
+      continue;
+
+    if (plane != NULL)
+      SB_to_board(SB_step(plane), board, 0, 0);
+    else
+      B_step_parallel(board, pool);
+    if (detector != NULL)
+      CD_observe(detector, board);
+    t++;
+    // A slow step delays the next one instead of skipping frames
+    tick += rate > 0 ? 1 / rate : 0;
+    if (tick < now())
+      tick = now();
+  }
+  if (plane != NULL)
+    SB_destroy(plane);
+  if (detector != NULL)
+    CD_destroy(detector);
+  F_destroy(frame);
+  B_destroy(board);
   restore_console();
 }
@@ -3,6 +3,22 @@
 #include <CUnit/CUError.h>
 #include <CUnit/TestDB.h>
 #include <board.h>
+#include <string.h>
+#include <packed.h>
+#include <simd.h>
+#include <hashlife.h>
+#include <sparse.h>
+#include <frame.h>
+#include <pthread.h>
+#include <triple.h>
+#include <cycle.h>
+#include <snapshot.h>
+#include <pattern.h>
+#include <batch.h>
+#include <distributed.h>
+#include <stats.h>
+#include <arena.h>
+#include <texture.h>
 
 #define BOARD_HEIGHT (6)
 #define BOARD_WIDTH (6)
@@ -26,16 +42,21 @@ int board_compare(Board *b1, Board *b2) {
 
 /** Test only one cell without any neighbours */
 void test_lone_cell(void){
-  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR, 2);
+  Board *b_actual = AR_take(arena, 1);
   B_set_alive(b_actual, 2, 2);
   b_actual =  B_update(b_actual);
 
   CU_ASSERT_FALSE(B_is_alive(b_actual->cell[2][2]))
+  B_destroy(b_actual);
+  CU_ASSERT(AR_outstanding(arena) == 0);
+  AR_destroy(arena);
 }
 
 // Test the block position 
 void test_still_block(void) {
-  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR, 2);
+  Board *b_actual = AR_take(arena, 1);
   Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
 
   B_set_alive(b_actual, 1, 1);
@@ -53,11 +74,16 @@ void test_still_block(void) {
   CU_ASSERT(board_compare(b_actual, b_expect));
   b_actual = B_update(b_actual);
   CU_ASSERT(board_compare(b_actual, b_expect));
+  B_destroy(b_actual);
+  B_destroy(b_expect);
+  CU_ASSERT(AR_outstanding(arena) == 0);
+  AR_destroy(arena);
 }
 
 /** Test the blinker oscillation */
 void test_blinker(void) {
-  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR, 2);
+  Board *b_actual = AR_take(arena, 1);
   Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
 
   B_set_alive(b_actual, 2, 1);
@@ -76,11 +102,16 @@ void test_blinker(void) {
   b_actual = B_update(b_actual);
   b_actual = B_update(b_actual);
   CU_ASSERT(board_compare(b_actual, b_expect));
+  B_destroy(b_actual);
+  B_destroy(b_expect);
+  CU_ASSERT(AR_outstanding(arena) == 0);
+  AR_destroy(arena);
 }
 
 /** test the toad oscillation */
 void test_toad (){
-  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR, 2);
+  Board *b_actual = AR_take(arena, 1);
   Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
 
   B_set_alive(b_actual, 2, 1);
@@ -104,10 +135,14 @@ void test_toad (){
   b_actual = B_update(b_actual);
   b_actual = B_update(b_actual);
   CU_ASSERT(board_compare(b_actual, b_expect));
-
+  B_destroy(b_actual);
+  B_destroy(b_expect);
+  CU_ASSERT(AR_outstanding(arena) == 0);
+  AR_destroy(arena);
 }
 void test_circular_box(){
-  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR, 2);
+  Board *b_actual = AR_take(arena, 1);
   Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CIRCULAR);
 
   B_set_alive(b_actual, 0, 0);
@@ -123,6 +158,1084 @@ void test_circular_box(){
   B_set_alive(b_expect, b_expect->height - 1, 1);
 
   CU_ASSERT(board_compare(b_actual, b_expect));
+  B_destroy(b_actual);
+  B_destroy(b_expect);
+  CU_ASSERT(AR_outstanding(arena) == 0);
+  AR_destroy(arena);
+}
+
+/** Test that stepping in place matches B_update and reuses its two buffers */
+void test_step_in_place(void) {
+  Board *b_actual = B_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED);
+  Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED);
+  Cell *first = b_actual->cells;
+  Cell *second = b_actual->next;
+
+  B_set_alive(b_actual, 2, 1);
+  B_set_alive(b_actual, 2, 2);
+  B_set_alive(b_actual, 2, 3);
+  B_set_alive(b_expect, 2, 1);
+  B_set_alive(b_expect, 2, 2);
+  B_set_alive(b_expect, 2, 3);
+
+  for (int t = 0; t < 3; t++) {
+    Board *b_next = B_update(b_expect);
+    B_destroy(b_expect);
+    b_expect = b_next;
+    B_step(b_actual);
+    CU_ASSERT(board_compare(b_actual, b_expect));
+  }
+  CU_ASSERT(b_actual->cells == second && b_actual->next == first);
+  CU_ASSERT(b_actual->cell[1] == b_actual->cells + BOARD_WIDTH);
+  B_destroy(b_actual);
+  B_destroy(b_expect);
+}
+
+/**
+ * Steps a random board with both B_step and the packed kernel and checks that
+ * every generation matches.
+ * @param height Heigth of the board
+ * @param width Width of the board
+ * @param version Rules of the board
+ * @return 1 if all generations are equal
+ */
+int packed_matches(int height, int width, Version version) {
+  Board *board =
+      B_generate(B_new(height, width, version), 33, height * width + version);
+  Board *unpacked = B_new(height, width, version);
+  PackedBoard *packed = PB_from_board(board);
+  int equal = 1;
+
+  for (int t = 0; t < 20 && equal; t++) {
+    B_step(board);
+    PB_step(packed);
+    equal = board_compare(board, PB_to_board(packed, unpacked));
+  }
+  PB_destroy(packed);
+  B_destroy(unpacked);
+  B_destroy(board);
+  return equal;
+}
+
+/** Test that the bit-packed kernel follows both versions of the rules */
+void test_packed(void) {
+  int widths[] = {1, 6, 63, 64, 65, 130};
+  for (int k = 0; k < 6; k++) {
+    CU_ASSERT(packed_matches(17, widths[k], CLIPPED));
+    CU_ASSERT(packed_matches(17, widths[k], CIRCULAR));
+  }
+}
+
+/** Test that every vectorized kernel the CPU supports gives the same result */
+void test_packed_kernels(void) {
+  const char *names[] = {"avx2", "sse2", "scalar"};
+  const char *best = PB_kernel_name();
+  for (int k = 0; k < 3; k++) {
+    if (!PB_select_kernel(names[k]))
+      continue;
+    CU_ASSERT(packed_matches(33, 300, CLIPPED));
+    CU_ASSERT(packed_matches(33, 517, CIRCULAR));
+    CU_ASSERT(packed_matches(9, 128, CIRCULAR));
+  }
+  PB_select_kernel(best);
+}
+
+/** Test that row bands stepped by a thread pool match the serial result */
+void test_parallel(void) {
+  Version versions[] = {CLIPPED, CIRCULAR};
+  for (int threads = 1; threads <= 5; threads += 2) {
+    ThreadPool *pool = TP_new(threads);
+    for (int v = 0; v < 2; v++) {
+      Board *serial = B_generate(B_new(37, 41, versions[v]), 33, threads + v);
+      Board *parallel = B_new(37, 41, versions[v]);
+      for (int i = 0; i < serial->height; i++)
+        for (int j = 0; j < serial->width; j++)
+          parallel->cell[i][j] = serial->cell[i][j];
+
+      int equal = 1;
+      for (int t = 0; t < 10; t++) {
+        B_step(serial);
+        B_step_parallel(parallel, pool);
+        equal = equal && board_compare(serial, parallel);
+      }
+      CU_ASSERT(equal);
+      B_destroy(serial);
+      B_destroy(parallel);
+    }
+    TP_destroy(pool);
+  }
+}
+
+/** Test a board whose neighbour counts would not fit on the stack, with a
+ * glider crossing the edge of a chunk of columns */
+void test_large_board(void) {
+  int height = 3000, width = 3000;
+  int row = 1500, col = B_CHUNK < width ? B_CHUNK - 2 : width / 2;
+  Board *board = B_new(height, width, CLIPPED);
+
+  B_set_alive(board, row, col + 1);
+  B_set_alive(board, row + 1, col + 2);
+  B_set_alive(board, row + 2, col);
+  B_set_alive(board, row + 2, col + 1);
+  B_set_alive(board, row + 2, col + 2);
+
+  // After one period the glider moved one cell down and one cell right
+  for (int t = 0; t < 4; t++)
+    B_step(board);
+
+  int population = 0;
+  for (size_t k = 0; k < (size_t)height * width; k++)
+    population += B_is_alive(board->cells[k]);
+  CU_ASSERT(population == 5);
+  CU_ASSERT(B_is_alive(board->cell[row + 1][col + 2]));
+  CU_ASSERT(B_is_alive(board->cell[row + 2][col + 3]));
+  CU_ASSERT(B_is_alive(board->cell[row + 3][col + 1]));
+  CU_ASSERT(B_is_alive(board->cell[row + 3][col + 2]));
+  CU_ASSERT(B_is_alive(board->cell[row + 3][col + 3]));
+  B_destroy(board);
+}
+
+/**
+ * Updates the board through the HashLife engine, the counterpart of B_update
+ * for patterns that do not touch the edges
+ * @param board Pointer to struct board
+ * @return Pointer to the new board with updated cell values
+ */
+Board *hl_update(Board *board) {
+  HashLife *life = HL_step(HL_from_board(board), 0);
+  Board *new_board = B_new(board->height, board->width, board->version);
+  HL_to_board(life, new_board, 0, 0);
+  HL_destroy(life);
+  return new_board;
+}
+
+/** Test the still lifes and oscillators above through the HashLife engine */
+void test_hashlife(void) {
+  int block[][2] = {{1, 1}, {1, 2}, {2, 1}, {2, 2}};
+  int blinker[][2] = {{2, 1}, {2, 2}, {2, 3}};
+  int toad[][2] = {{2, 1}, {2, 2}, {2, 3}, {3, 0}, {3, 1}, {3, 2}};
+  int (*patterns[])[2] = {block, blinker, toad};
+  int sizes[] = {4, 3, 6};
+
+  Board *lone = B_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED);
+  B_set_alive(lone, 2, 2);
+  Board *b_actual = hl_update(lone);
+  CU_ASSERT_FALSE(B_is_alive(b_actual->cell[2][2]));
+  B_destroy(b_actual);
+  B_destroy(lone);
+
+  for (int p = 0; p < 3; p++) {
+    Board *b_expect = B_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED);
+    for (int k = 0; k < sizes[p]; k++)
+      B_set_alive(b_expect, patterns[p][k][0], patterns[p][k][1]);
+    b_actual = hl_update(b_expect);
+    B_step(b_expect);
+    CU_ASSERT(board_compare(b_actual, b_expect));
+    B_destroy(b_actual);
+    B_destroy(b_expect);
+  }
+}
+
+/** Test jumps of 2^k generations against single steps */
+void test_hashlife_jump(void) {
+  // A glider moves by one cell diagonally every 4 generations
+  HashLife *life = HL_new();
+  HL_set_alive(life, 0, 1);
+  HL_set_alive(life, 1, 2);
+  HL_set_alive(life, 2, 0);
+  HL_set_alive(life, 2, 1);
+  HL_set_alive(life, 2, 2);
+  HL_step(life, 20);
+  CU_ASSERT(HL_population(life) == 5);
+  CU_ASSERT(life->generation == 1 << 20);
+  CU_ASSERT(HL_is_alive(life, (1 << 18) + 0, (1 << 18) + 1));
+  CU_ASSERT(HL_is_alive(life, (1 << 18) + 2, (1 << 18) + 2));
+  HL_destroy(life);
+
+  // A soup advanced at once matches the same soup advanced one by one
+  Board *soup = B_generate(B_new(16, 16, CLIPPED), 40, 3);
+  HashLife *jump = HL_advance(HL_from_board(soup), 100);
+  HashLife *walk = HL_from_board(soup);
+  for (int t = 0; t < 100; t++)
+    HL_step(walk, 0);
+  Board *b_jump = HL_to_board(jump, B_new(232, 232, CLIPPED), -108, -108);
+  Board *b_walk = HL_to_board(walk, B_new(232, 232, CLIPPED), -108, -108);
+  CU_ASSERT(HL_population(jump) == HL_population(walk));
+  CU_ASSERT(board_compare(b_jump, b_walk));
+  B_destroy(b_jump);
+  B_destroy(b_walk);
+  B_destroy(soup);
+  HL_destroy(jump);
+  HL_destroy(walk);
+}
+
+/** Test that skipping inactive tiles gives the same generations and that
+ * only the tiles around activity are computed */
+void test_activity(void) {
+  Version versions[] = {CLIPPED, CIRCULAR};
+  ThreadPool *pool = TP_new(3);
+  for (int v = 0; v < 2; v++) {
+    Board *full = B_generate(B_new(150, 200, versions[v]), 33, 4 + v);
+    Board *tracked = B_new(150, 200, versions[v]);
+    memcpy(tracked->cells, full->cells, 150 * 200 * sizeof(Cell));
+    B_track_activity(tracked, 1);
+
+    int equal = 1;
+    for (int t = 0; t < 60; t++) {
+      B_step(full);
+      if (t % 2)
+        B_step(tracked);
+      else
+        B_step_parallel(tracked, pool);
+      equal = equal && board_compare(full, tracked);
+    }
+    CU_ASSERT(equal);
+    B_destroy(full);
+    B_destroy(tracked);
+  }
+  TP_destroy(pool);
+
+  // A lone blinker only keeps its own tile and the neighbouring ones active
+  Board *board = B_new(8 * B_TILE, 8 * B_TILE, CLIPPED);
+  B_track_activity(board, 1);
+  B_set_alive(board, 3 * B_TILE + 10, 3 * B_TILE + 9);
+  B_set_alive(board, 3 * B_TILE + 10, 3 * B_TILE + 10);
+  B_set_alive(board, 3 * B_TILE + 10, 3 * B_TILE + 11);
+  B_step(board);
+  CU_ASSERT(B_active_tiles(board) == 64);
+  B_step(board);
+  CU_ASSERT(B_active_tiles(board) == 9);
+  B_step(board);
+  CU_ASSERT(B_active_tiles(board) == 9);
+  CU_ASSERT(B_is_alive(board->cell[3 * B_TILE + 9][3 * B_TILE + 10]));
+  B_destroy(board);
+}
+
+/** Test the unbounded sparse board against a board whose borders the pattern
+ * never reaches, and far away from the origin */
+void test_sparse(void) {
+  Board *soup = B_generate(B_new(40, 40, CLIPPED), 35, 5);
+  Board *board = B_new(400, 400, CLIPPED);
+  Board *window = B_new(400, 400, UNBOUNDED);
+  for (int i = 0; i < 40; i++)
+    for (int j = 0; j < 40; j++)
+      if (B_is_alive(soup->cell[i][j]))
+        B_set_alive(board, 180 + i, 180 + j);
+
+  // The soup straddles the chunks around the origin of the plane
+  SparseBoard *sparse = SB_from_board(soup, -20, -20);
+  int equal = 1;
+  for (int t = 0; t < 100; t++) {
+    B_step(board);
+    SB_step(sparse);
+    equal = equal && board_compare(board, SB_to_board(sparse, window, -200,
+                                                      -200));
+  }
+  CU_ASSERT(equal);
+  CU_ASSERT(sparse->generation == 100);
+  SB_destroy(sparse);
+  B_destroy(window);
+  B_destroy(board);
+  B_destroy(soup);
+
+  // A glider far from the origin only ever needs a few chunks
+  int64_t far = (int64_t)1 << 40;
+  sparse = SB_new();
+  SB_set_alive(sparse, far + 0, -far + 1);
+  SB_set_alive(sparse, far + 1, -far + 2);
+  SB_set_alive(sparse, far + 2, -far + 0);
+  SB_set_alive(sparse, far + 2, -far + 1);
+  SB_set_alive(sparse, far + 2, -far + 2);
+  for (int t = 0; t < 400; t++)
+    SB_step(sparse);
+  CU_ASSERT(SB_population(sparse) == 5);
+  CU_ASSERT(SB_chunks(sparse) <= 4);
+  CU_ASSERT(SB_is_alive(sparse, far + 100 + 2, -far + 100 + 2));
+  SB_set_dead(sparse, far + 100 + 2, -far + 100 + 2);
+  CU_ASSERT_FALSE(SB_is_alive(sparse, far + 100 + 2, -far + 100 + 2));
+  SB_destroy(sparse);
+
+  // Once a burst of lone cells dies, its chunks and map slots are given back
+  sparse = SB_new();
+  for (int k = 0; k < 2000; k++)
+    SB_set_alive(sparse, (int64_t)k * 3 * SB_CHUNK, 5);
+  CU_ASSERT(SB_chunks(sparse) == 2000 && sparse->map.capacity >= 4000);
+  SB_step(sparse);
+  SB_step(sparse);
+  CU_ASSERT(SB_population(sparse) == 0 && SB_chunks(sparse) == 0);
+  CU_ASSERT(sparse->spare <= SB_FREE_CHUNKS);
+  CU_ASSERT(sparse->map.capacity <= 128 && sparse->next.capacity <= 128);
+  SB_destroy(sparse);
+}
+
+/** Test that generation only depends on the seed, not on the threads or on
+ * the engine, and gives about the asked density */
+void test_generate(void) {
+  Board *serial = B_generate(B_new(93, 131, CLIPPED), 30, 42);
+  PackedBoard *packed = PB_generate(PB_new(93, 131, CLIPPED), 30, 42, NULL);
+  Board *unpacked = PB_to_board(packed, B_new(93, 131, CLIPPED));
+  CU_ASSERT(board_compare(serial, unpacked));
+
+  for (int threads = 1; threads <= 3; threads += 2) {
+    ThreadPool *pool = TP_new(threads);
+    Board *parallel = B_generate_parallel(B_new(93, 131, CLIPPED), 30, 42, pool);
+    CU_ASSERT(board_compare(serial, parallel));
+    PB_generate(packed, 30, 42, pool);
+    CU_ASSERT(board_compare(serial, PB_to_board(packed, unpacked)));
+    B_destroy(parallel);
+    TP_destroy(pool);
+  }
+
+  int alive = (int)PB_population(packed);
+  CU_ASSERT(alive > 93 * 131 * 27 / 100 && alive < 93 * 131 * 33 / 100);
+  B_generate(unpacked, 30, 43);
+  CU_ASSERT(!board_compare(serial, unpacked));
+
+  PB_destroy(packed);
+  B_destroy(serial);
+  B_destroy(unpacked);
+}
+
+/** Counts the occurrences of a string in the buffer of a frame */
+static int frame_count(Frame *frame, const char *text) {
+  int count = 0;
+  size_t size = strlen(text);
+  for (size_t k = 0; k + size <= frame->length; k++)
+    if (memcmp(frame->buffer + k, text, size) == 0) {
+      count++;
+      k += size - 1;
+    }
+  return count;
+}
+
+/** Test that frames only redraw the cells that changed since the last one */
+void test_frame(void) {
+  Board *board = B_new(6, 10, CLIPPED);
+  Frame *frame = F_new(6, 10, 2);
+
+  // First frame clears the screen and draws one colour span per row
+  F_build(frame, board, "(t : 0)");
+  CU_ASSERT(frame_count(frame, "\x1b[2J") == 1);
+  CU_ASSERT(frame_count(frame, "\x1b[47m") == 1);
+  CU_ASSERT(frame_count(frame, "  ") == 60);
+
+  // Nothing changed, only the status line is written
+  F_build(frame, board, "(t : 1)");
+  CU_ASSERT(frame_count(frame, "  ") == 0);
+  CU_ASSERT(frame_count(frame, "(t : 1)") == 1);
+
+  // A blinker row is one move and one span, a far cell is another move
+  B_set_alive(board, 2, 3);
+  B_set_alive(board, 2, 4);
+  B_set_alive(board, 2, 5);
+  B_set_alive(board, 5, 9);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "\x1b[4;7H") == 1);
+  CU_ASSERT(frame_count(frame, "\x1b[7;19H") == 1);
+  CU_ASSERT(frame_count(frame, "\x1b[41m") == 1);
+  CU_ASSERT(frame_count(frame, "  ") == 4);
+
+  // Cells close to each other are joined by redrawing the gap
+  B_step(board);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "  ") == 6);
+
+  F_invalidate(frame);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "  ") == 60);
+
+  F_destroy(frame);
+  B_destroy(board);
+}
+
+/** Test that the hash follows the steps and finds still lifes and
+ * oscillators */
+void test_cycle(void) {
+  Board *board = B_new(20, 20, CLIPPED);
+  B_set_alive(board, 5, 4);
+  B_set_alive(board, 5, 5);
+  B_set_alive(board, 5, 6);
+  CycleDetector *detector = CD_new(board);
+  CU_ASSERT(CD_observe(detector, B_step(board)) == 0);
+  CU_ASSERT(detector->hash == CD_hash(board));
+  CU_ASSERT(CD_observe(detector, B_step(board)) == 2);
+  CU_ASSERT(detector->start == 0);
+  CU_ASSERT(CD_skip(detector, 1001) == 1);
+  CU_ASSERT(CD_skip(detector, 1) == 0);
+  CD_destroy(detector);
+
+  // A soup with activity tracking, hashed incrementally all along
+  Version versions[] = {CLIPPED, CIRCULAR};
+  for (int v = 0; v < 2; v++) {
+    Board *soup = B_generate(B_new(150, 130, versions[v]), 30, 11 + v);
+    B_track_activity(soup, v == 0);
+    detector = CD_new(soup);
+    int equal = 1;
+    for (int t = 0; t < 2000 && CD_observe(detector, B_step(soup)) == 0; t++)
+      equal = equal && detector->hash == CD_hash(soup);
+    CU_ASSERT(equal);
+    CU_ASSERT(detector->period > 0);
+
+    // Going around the cycle comes back to the same cells
+    Board *copy = B_new(150, 130, versions[v]);
+    for (int i = 0; i < soup->height; i++)
+      for (int j = 0; j < soup->width; j++)
+        copy->cell[i][j] = soup->cell[i][j];
+    for (long long k = 0; k < detector->period; k++)
+      B_step(soup);
+    CU_ASSERT(board_compare(soup, copy));
+    CD_destroy(detector);
+    B_destroy(copy);
+    B_destroy(soup);
+  }
+  B_destroy(board);
+}
+
+/** Test that snapshots load back the saved board and reject damaged files */
+void test_snapshot(void) {
+  const char *path = "test_snapshot.snap";
+  Board *board = B_generate(B_new(70, 131, CIRCULAR), 35, 21);
+  uint64_t generation = 0;
+
+  CU_ASSERT(SN_save(path, board, 42, 1) == 0);
+  Board *loaded = SN_load(path, &generation);
+  CU_ASSERT_PTR_NOT_NULL_FATAL(loaded);
+  CU_ASSERT(generation == 42 && loaded->version == CIRCULAR);
+  CU_ASSERT(board_compare(board, loaded));
+
+  // The mapped generation steps like the original and saves the same file
+  PackedBoard *packed = SN_load_packed(path, NULL);
+  CU_ASSERT_PTR_NOT_NULL_FATAL(packed);
+  CU_ASSERT(packed->mapping != NULL);
+  for (int t = 0; t < 3; t++) {
+    PB_step(packed);
+    B_step(board);
+  }
+  // The mapping stays one of the generations, only one more is allocated
+  CU_ASSERT(packed->mapping != NULL);
+  CU_ASSERT(packed->next == packed->block || packed->bits == packed->block);
+  CU_ASSERT(board_compare(board, PB_to_board(packed, loaded)));
+  CU_ASSERT(SN_save_packed(path, packed, 45, 1) == 0);
+  B_destroy(loaded);
+  loaded = SN_load(path, &generation);
+  CU_ASSERT(generation == 45 && board_compare(board, loaded));
+  B_destroy(loaded);
+  PB_destroy(packed);
+
+  // A flipped bit is caught by the checksum
+  FILE *file = fopen(path, "r+b");
+  fseek(file, sizeof(SN_Header) + 100, SEEK_SET);
+  fputc(fgetc(file) ^ 1, file);
+  fclose(file);
+  CU_ASSERT_PTR_NULL(SN_load(path, NULL));
+  remove(path);
+  B_destroy(board);
+}
+
+/** Test that patterns are read at an offset and written back in every format */
+void test_pattern(void) {
+  const char *paths[] = {"test_pattern.rle", "test_pattern.cells",
+                         "test_pattern.lif"};
+  Board *board = B_new(20, 30, CLIPPED);
+  int64_t top, left, height, width;
+
+  // Glider over three rows, a blank row and a run of 12 cells
+  FILE *file = fopen("test_glider.rle", "w");
+  fputs("#N glider\nx = 12, y = 5, rule = B3/S23\nbo$2bo$3o2$12o!\n", file);
+  fclose(file);
+  CU_ASSERT(PT_format("test_glider.rle") == PT_RLE);
+  CU_ASSERT(PT_bounds("test_glider.rle", &top, &left, &height, &width) == 0);
+  CU_ASSERT(top == 0 && left == 0 && height == 5 && width == 12);
+  CU_ASSERT(PT_load("test_glider.rle", board, 3, 7) == 0);
+  CU_ASSERT(board->cell[3][8] == ALIVE && board->cell[4][9] == ALIVE);
+  CU_ASSERT(board->cell[5][7] == ALIVE && board->cell[5][9] == ALIVE);
+  CU_ASSERT(board->cell[6][7] == DEAD && board->cell[7][18] == ALIVE);
+  CU_ASSERT(board->cell[7][19] == DEAD && board->cell[3][7] == DEAD);
+
+  // Every format reads back the board it wrote
+  for (int k = 0; k < 3; k++) {
+    Board *loaded = B_new(20, 30, CLIPPED);
+    CU_ASSERT(PT_save(paths[k], board, PT_UNKNOWN) == 0);
+    CU_ASSERT(PT_format(paths[k]) == (PatternFormat)k);
+    CU_ASSERT(PT_load(paths[k], loaded, 0, 0) == 0);
+    CU_ASSERT(board_compare(board, loaded));
+    B_destroy(loaded);
+  }
+
+  // A circular board wraps the pattern, the others clip it
+  Board *circular = B_new(20, 30, CIRCULAR);
+  Board *clipped = B_new(20, 30, CLIPPED);
+  CU_ASSERT(PT_load("test_glider.rle", circular, 17, 25) == 0);
+  CU_ASSERT(PT_load("test_glider.rle", clipped, 17, 25) == 0);
+  CU_ASSERT(circular->cell[17][26] == ALIVE && circular->cell[19][25] == ALIVE);
+  CU_ASSERT(circular->cell[1][29] == ALIVE && circular->cell[1][0] == ALIVE);
+  CU_ASSERT(circular->cell[1][6] == ALIVE && circular->cell[1][7] == DEAD);
+  CU_ASSERT(clipped->cell[19][25] == ALIVE && clipped->cell[1][0] == DEAD);
+
+  // The sparse plane keeps the cells out of any board
+  SparseBoard *sparse = SB_new();
+  CU_ASSERT(PT_load_sparse("test_pattern.lif", sparse, -1000, 5000) == 0);
+  CU_ASSERT(SB_population(sparse) == 17);
+  CU_ASSERT(SB_is_alive(sparse, -993, 5018));
+  CU_ASSERT(PT_load("test_pattern.missing", board, 0, 0) == -1);
+
+  // RLE files keep the rule of the board they were written from
+  Rule rule;
+  CU_ASSERT(PT_rule("test_glider.rle", &rule) == 1 && RU_is_life(&rule));
+  CU_ASSERT(PT_rule("test_pattern.cells", &rule) == 0);
+  B_set_rule(board, RU_make(&rule, (1 << 3) | (1 << 6), (1 << 2) | (1 << 3),
+                             2));
+  CU_ASSERT(PT_save("test_pattern.rle", board, PT_RLE) == 0);
+  CU_ASSERT(PT_rule("test_pattern.rle", &rule) == 1);
+  CU_ASSERT(rule.birth == ((1 << 3) | (1 << 6)) && rule.states == 2);
+  // Empty rows are merged and the runs wrap no line of this short body
+  file = fopen("test_pattern.rle", "r");
+  char header[128], body[128];
+  CU_ASSERT(fgets(header, sizeof(header), file) != NULL &&
+            fgets(body, sizeof(body), file) != NULL);
+  CU_ASSERT(strncmp(body, "3$8bo$9bo$7b3o2$7b12o!", 22) == 0);
+  fclose(file);
+
+  // Files only hold alive and dead cells, dying states are refused
+  Board *dying = B_set_rule(B_new(4, 4, CLIPPED), RU_make(&rule, 1 << 2, 0, 3));
+  dying->cell[1][1] = DYING;
+  CU_ASSERT(PT_save("test_pattern.rle", dying, PT_RLE) == -1);
+  B_destroy(dying);
+
+  SB_destroy(sparse);
+  for (int k = 0; k < 3; k++)
+    remove(paths[k]);
+  remove("test_glider.rle");
+  B_destroy(circular);
+  B_destroy(clipped);
+  B_destroy(board);
+}
+
+/** Test that parsed rules step the board and the packed board alike */
+void test_rule(void) {
+  Rule rule;
+  char name[RU_NAME];
+
+  CU_ASSERT(RU_parse(&rule, "B3/S23") == 0 && RU_is_life(&rule));
+  CU_ASSERT(rule.bits == RU_LIFE_BITS);
+  CU_ASSERT(RU_parse(&rule, "23/3") == 0 && RU_is_life(&rule));
+  CU_ASSERT(RU_parse(&rule, "b36/s23") == 0 && !RU_is_life(&rule));
+  RU_format(&rule, name, sizeof(name));
+  CU_ASSERT(strcmp(name, "B36/S23") == 0);
+  CU_ASSERT(RU_parse(&rule, "B2/S/C3") == 0 && rule.states == 3);
+  RU_format(&rule, name, sizeof(name));
+  CU_ASSERT(strcmp(name, "B2/S/C3") == 0);
+  CU_ASSERT(RU_parse(&rule, "345/2/4") == 0 && rule.states == 4);
+  CU_ASSERT(rule.birth == (1 << 2) && rule.survival == 0x38);
+  CU_ASSERT(RU_parse(&rule, "B9/S23") == -1);
+  CU_ASSERT(RU_parse(&rule, "B3/S23/C1") == -1);
+  CU_ASSERT(RU_parse(&rule, "life") == -1);
+  CU_ASSERT(rule.states == 4);
+
+  // HighLife gives birth with six neighbours
+  Board *board = B_new(5, 5, CLIPPED);
+  RU_parse(&rule, "B36/S23");
+  B_set_rule(board, &rule);
+  int cells[6][2] = {{1, 1}, {1, 2}, {1, 3}, {3, 1}, {3, 2}, {3, 3}};
+  for (int k = 0; k < 6; k++)
+    B_set_alive(board, cells[k][0], cells[k][1]);
+  B_step(board);
+  CU_ASSERT(board->cell[2][2] == ALIVE);
+  B_destroy(board);
+
+  // Brian's Brain: an alive cell is dying for one generation, then dead
+  board = B_new(6, 6, CIRCULAR);
+  RU_parse(&rule, "B2/S/C3");
+  B_set_rule(board, &rule);
+  B_set_alive(board, 2, 2);
+  B_set_alive(board, 2, 3);
+  B_step(board);
+  CU_ASSERT(board->cell[2][2] == DYING && board->cell[2][3] == DYING);
+  CU_ASSERT(board->cell[1][2] == ALIVE && board->cell[3][3] == ALIVE);
+  CU_ASSERT(board->cell[1][1] == DEAD && board->cell[1][4] == DEAD);
+  B_step(board);
+  CU_ASSERT(board->cell[2][2] == DEAD && board->cell[1][2] == DYING);
+  B_destroy(board);
+
+  // The truth table of the packed kernel matches the lookup table
+  const char *rules[] = {"B36/S23", "B3678/S34678", "B1357/S1357", "B2/S"};
+  for (int k = 0; k < 4; k++) {
+    Board *b = B_generate(B_new(70, 131, k % 2 ? CIRCULAR : CLIPPED), 40, k);
+    RU_parse(&rule, rules[k]);
+    B_set_rule(b, &rule);
+    PackedBoard *packed = PB_from_board(b);
+    Board *check = B_new(70, 131, b->version);
+    for (int t = 0; t < 10; t++) {
+      B_step(b);
+      PB_step(packed);
+    }
+    CU_ASSERT(board_compare(b, PB_to_board(packed, check)));
+    PB_destroy(packed);
+    B_destroy(check);
+    B_destroy(b);
+  }
+
+  // The packed board has no dying states
+  PackedBoard *packed = PB_new(4, 4, CLIPPED);
+  RU_parse(&rule, "B2/S/C3");
+  CU_ASSERT_PTR_NULL(PB_set_rule(packed, &rule));
+  CU_ASSERT(packed->rule == RU_LIFE_BITS);
+  PB_destroy(packed);
+}
+
+/** Collects the results of a batch, see test_batch */
+static void batch_collect(void *target, const BatchResult *result) {
+  BatchResult *results = (BatchResult *)target;
+  results[result->index] = *result;
+}
+
+/** Test that a batch gives the same results whatever the number of threads */
+void test_batch(void) {
+  BatchSpec spec;
+  static BatchResult alone[1500], pooled[1500];
+  ThreadPool *pool = TP_new(3);
+  int ordered = 1, same = 1;
+
+  BA_spec(&spec, 12, 12, CLIPPED, 35, 77, 200);
+  BA_run(&spec, 1500, NULL, batch_collect, alone);
+  BA_run(&spec, 1500, pool, batch_collect, pooled);
+  for (int k = 0; k < 1500; k++) {
+    ordered &= alone[k].index == k;
+    same &= memcmp(&alone[k], &pooled[k], sizeof(BatchResult)) == 0;
+  }
+  CU_ASSERT(ordered && same);
+
+  // A board stepped alone from its seed ends like in the batch
+  Board *board = B_generate(B_new(12, 12, CLIPPED), 35, alone[1234].seed);
+  for (long long t = 0; t < alone[1234].generations; t++)
+    B_step(board);
+  long long population = 0;
+  for (int k = 0; k < 12 * 12; k++)
+    population += B_is_alive(board->cells[k]);
+  CU_ASSERT(population == alone[1234].population);
+  CU_ASSERT(alone[1234].period == 0 ||
+            alone[1234].start + alone[1234].period ==
+                alone[1234].generations);
+  B_destroy(board);
+  TP_destroy(pool);
+}
+
+/** Test that the workers step the board like B_step, whatever the strips */
+void test_distributed(void) {
+  Version versions[2] = {CLIPPED, CIRCULAR};
+  Rule rule;
+  int same = 1, counted = 1;
+
+  RU_parse(&rule, "B36/S23");
+  for (int v = 0; v < 2; v++)
+    for (int workers = 1; workers <= 3; workers++) {
+      // With 3 workers on 5 rows, the first strip only has one row
+      int height = workers == 3 ? 5 : 23;
+      Board *board = B_generate(B_new(height, 70, versions[v]), 40, 9);
+      Board *gathered = B_new(height, 70, versions[v]);
+      Distributed *ds = DS_new(height, 70, versions[v], &rule, workers);
+      B_set_rule(board, &rule);
+      DS_generate(ds, 40, 9);
+      uint64_t population = DS_step(ds, 17);
+      for (int t = 0; t < 17; t++)
+        B_step(board);
+      DS_gather(ds, gathered);
+      uint64_t count = 0;
+      for (int k = 0; k < height * 70; k++) {
+        same &= gathered->cells[k] == board->cells[k];
+        count += B_is_alive(board->cells[k]);
+      }
+      counted &= population == count && DS_population(ds) == count;
+      DS_destroy(ds);
+      B_destroy(gathered);
+      B_destroy(board);
+    }
+  CU_ASSERT(same);
+  CU_ASSERT(counted);
+
+  // A scattered board is saved as SN_save would
+  const char *path = "test_distributed.snap";
+  Board *board = B_generate(B_new(31, 130, CIRCULAR), 30, 4);
+  Distributed *ds = DS_new(31, 130, CIRCULAR, NULL, 4);
+  DS_scatter(ds, board);
+  DS_step(ds, 5);
+  for (int t = 0; t < 5; t++)
+    B_step(board);
+  CU_ASSERT(DS_save(ds, path, 1) == 0);
+  uint64_t generation = 0;
+  Board *loaded = SN_load(path, &generation);
+  CU_ASSERT_PTR_NOT_NULL_FATAL(loaded);
+  CU_ASSERT(generation == 5);
+  CU_ASSERT(memcmp(loaded->cells, board->cells, 31 * 130 * sizeof(Cell)) == 0);
+  B_destroy(loaded);
+  DS_destroy(ds);
+  B_destroy(board);
+  remove(path);
+}
+
+/** Test that temporal blocking steps the board like as many B_step */
+void test_blocked(void) {
+  Version versions[2] = {CLIPPED, CIRCULAR};
+  const char *rules[2] = {"B3/S23", "B2/S/C4"};
+  int same = 1;
+
+  for (int v = 0; v < 2; v++)
+    for (int r = 0; r < 2; r++) {
+      Rule rule;
+      RU_parse(&rule, rules[r]);
+      // Tiles and halos smaller than the board, then larger than it
+      int shapes[3][4] = {{23, 41, 7, 3}, {23, 41, 16, 5}, {5, 4, 3, 4}};
+      for (int k = 0; k < 3; k++) {
+        int height = shapes[k][0], width = shapes[k][1];
+        Board *board = B_new(height, width, versions[v]);
+        Board *blocked = B_new(height, width, versions[v]);
+        B_set_rule(B_generate(board, 40, 5 + k), &rule);
+        B_set_rule(B_generate(blocked, 40, 5 + k), &rule);
+        for (int t = 0; t < 17; t++)
+          B_step(board);
+        B_step_blocked(blocked, 17, shapes[k][2], shapes[k][3], NULL);
+        same &= memcmp(board->cells, blocked->cells,
+                       (size_t)height * width * sizeof(Cell)) == 0;
+        B_destroy(blocked);
+        B_destroy(board);
+      }
+    }
+  CU_ASSERT(same);
+
+  // Bands of tiles on threads, then the tuned shape
+  ThreadPool *pool = TP_new(3);
+  Board *board = B_generate(B_new(300, 290, CIRCULAR), 35, 8);
+  Board *blocked = B_generate(B_new(300, 290, CIRCULAR), 35, 8);
+  for (int t = 0; t < 50; t++)
+    B_step(board);
+  B_step_blocked(blocked, 40, 64, 8, pool);
+  B_step_n(blocked, 10, pool);
+  CU_ASSERT(memcmp(board->cells, blocked->cells,
+                   300 * 290 * sizeof(Cell)) == 0);
+  B_destroy(blocked);
+  B_destroy(board);
+  TP_destroy(pool);
+}
+
+/** Checks the statistics of the last step against the cells of the board
+ * before and after it, see test_stats */
+static int stats_match(const Stats *stats, const Cell *before, Board *board) {
+  long long population = 0, births = 0, deaths = 0;
+  int top = -1, left = -1, bottom = -1, right = -1;
+  for (int i = 0; i < board->height; i++)
+    for (int j = 0; j < board->width; j++) {
+      int now = board->cell[i][j] == ALIVE;
+      int was = before[(size_t)i * board->width + j] == ALIVE;
+      population += now;
+      births += now && !was;
+      deaths += was && !now;
+      if (now) {
+        top = top < 0 ? i : top;
+        bottom = i;
+        left = left < 0 || j < left ? j : left;
+        right = j > right ? j : right;
+      }
+    }
+  return stats->population == population && stats->births == births &&
+         stats->deaths == deaths && stats->top == top &&
+         stats->left == left && stats->bottom == bottom &&
+         stats->right == right;
+}
+
+/** Test that the steps gather the statistics of every generation */
+void test_stats(void) {
+  ThreadPool *pool = TP_new(3);
+  StatsCollector *stats = ST_new(NULL, ST_CSV, 1);
+  Board *board = B_generate(B_new(150, 140, CLIPPED), 20, 6);
+  Cell *before = (Cell *)malloc(150 * 140 * sizeof(Cell));
+  int match = 1;
+
+  // Plain, threaded and tracked steps, then B_update
+  B_collect_stats(board, stats);
+  for (int t = 0; t < 30; t++) {
+    memcpy(before, board->cells, 150 * 140 * sizeof(Cell));
+    if (t == 20)
+      B_track_activity(board, 1);
+    if (t % 2 == 0)
+      B_step(board);
+    else
+      B_step_parallel(board, pool);
+    match &= stats_match(&stats->last, before, board);
+  }
+  memcpy(before, board->cells, 150 * 140 * sizeof(Cell));
+  Board *updated = B_update(board);
+  match &= stats_match(&stats->last, before, updated);
+  CU_ASSERT(match);
+  CU_ASSERT(stats->last.generation == 31);
+  CU_ASSERT(stats->last.seconds[ST_COUNT] > 0);
+  CU_ASSERT(stats->last.seconds[ST_RULE] > 0);
+  CU_ASSERT(stats->last.seconds[ST_ALLOC] > 0);
+  B_destroy(updated);
+  ST_destroy(stats);
+
+  // An empty board has no bounding box
+  Board *empty = B_new(8, 8, CIRCULAR);
+  stats = ST_new(NULL, ST_JSONL, 0);
+  B_collect_stats(empty, stats);
+  B_step(empty);
+  CU_ASSERT(stats->last.population == 0 && stats->last.top == -1 &&
+            stats->last.right == -1);
+  CU_ASSERT(stats->last.seconds[ST_COUNT] == 0);
+  ST_destroy(stats);
+  B_destroy(empty);
+
+  // Every generation is a line, written when the next one ends
+  const char *formats[2] = {"generation,population,births,deaths,",
+                            "{\"generation\":1,\"population\":"};
+  for (int f = 0; f < 2; f++) {
+    FILE *file = tmpfile();
+    char line[512];
+    int lines = 0;
+    stats = ST_new(file, (StatsFormat)f, 0);
+    B_collect_stats(board, stats);
+    for (int t = 0; t < 3; t++)
+      B_step(board);
+    ST_time(stats, ST_RENDER, 0.5);
+    ST_destroy(stats);
+    rewind(file);
+    CU_ASSERT(fgets(line, sizeof(line), file) != NULL &&
+              strncmp(line, formats[f], strlen(formats[f])) == 0);
+    while (fgets(line, sizeof(line), file) != NULL)
+      lines++;
+    CU_ASSERT(lines == (f == ST_CSV ? 3 : 2));
+    // The time spent drawing goes to the last generation
+    CU_ASSERT(strstr(line, f == ST_CSV ? ",0.500000000,"
+                                       : "\"render_seconds\":0.500000000") !=
+              NULL);
+    fclose(file);
+  }
+  B_destroy(board);
+  free(before);
+  TP_destroy(pool);
+}
+
+/** Computes the next state of a cell by counting its neighbours one by one,
+ * see test_kernels */
+static Cell naive_next(Board *board, int i, int j) {
+  int population = 0;
+  for (int di = -1; di <= 1; di++)
+    for (int dj = -1; dj <= 1; dj++) {
+      int r = i + di, c = j + dj;
+      if (board->version == CIRCULAR) {
+        r = (r + board->height) % board->height;
+        c = (c + board->width) % board->width;
+      } else if (r < 0 || c < 0 || r >= board->height || c >= board->width) {
+        continue;
+      }
+      population += board->cell[r][c] == ALIVE;
+    }
+  return (Cell)board->rule.next[board->cell[i][j]][population];
+}
+
+/** Test that every specialized kernel steps like counting the neighbours */
+void test_kernels(void) {
+  int widths[3] = {10, 50, 37}, heights[4] = {1, 2, 10, 50};
+  const char *rules[2] = {"B3/S23", "B2/S/C3"};
+  int same = 1;
+
+  for (int v = 0; v < 2; v++)
+    for (int r = 0; r < 2; r++)
+      for (int w = 0; w < 3; w++)
+        for (int h = 0; h < 4; h++) {
+          Rule rule;
+          RU_parse(&rule, rules[r]);
+          Board *board = B_new(heights[h], widths[w], (Version)v);
+          Cell *expected =
+              (Cell *)malloc((size_t)heights[h] * widths[w] * sizeof(Cell));
+          B_set_rule(B_generate(board, 45, 3 + h), &rule);
+          for (int t = 0; t < 4; t++) {
+            for (int i = 0; i < heights[h]; i++)
+              for (int j = 0; j < widths[w]; j++)
+                expected[i * widths[w] + j] = naive_next(board, i, j);
+            B_step(board);
+            same &= memcmp(expected, board->cells,
+                           (size_t)heights[h] * widths[w] * sizeof(Cell)) == 0;
+          }
+          free(expected);
+          B_destroy(board);
+        }
+  CU_ASSERT(same);
+
+  // Kernels follow the version, the rule and the width of the board
+  Rule rule;
+  Board *board = B_new(10, 10, CIRCULAR);
+  CU_ASSERT(strcmp(B_kernel_name(board), "circular-10") == 0);
+  B_destroy(board);
+  board = B_new(50, 50, CLIPPED);
+  CU_ASSERT(strcmp(B_kernel_name(board), "clipped-50") == 0);
+  B_set_rule(board, RU_make(&rule, 1 << 2, 0, 4));
+  CU_ASSERT(strcmp(B_kernel_name(board), "clipped-dying-50") == 0);
+  B_destroy(board);
+  board = B_new(20, 37, UNBOUNDED);
+  CU_ASSERT(strcmp(B_kernel_name(board), "clipped") == 0);
+  B_destroy(board);
+}
+
+/** Test that B_update chains reuse the boards of their arena */
+void test_arena(void) {
+  BoardArena *arena = AR_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED, 2);
+  Board *board = AR_take(arena, 1);
+  Board *plain = B_new(BOARD_HEIGHT, BOARD_WIDTH, CLIPPED);
+  Cell *buffers[2] = {NULL, NULL};
+  int reused = 1, same = 1;
+
+  B_set_alive(board, 2, 1);
+  B_set_alive(board, 2, 2);
+  B_set_alive(board, 2, 3);
+  B_set_alive(plain, 2, 1);
+  B_set_alive(plain, 2, 2);
+  B_set_alive(plain, 2, 3);
+  for (int t = 0; t < 10; t++) {
+    board = B_update(board);
+    B_step(plain);
+    same &= board_compare(board, plain);
+    // The chain only ever uses the two boards made by AR_new
+    if (t < 2)
+      buffers[t] = board->cells;
+    else
+      reused &= board->cells == buffers[t % 2];
+    reused &= AR_outstanding(arena) == 1 && arena->count == 2;
+  }
+  CU_ASSERT(same);
+  CU_ASSERT(reused);
+
+  // A reset board is dead, a third board is only made when none is spare
+  Board *other = AR_take(arena, 1);
+  CU_ASSERT(B_is_alive(other->cell[2][2]) == 0);
+  CU_ASSERT(arena->count == 2 && AR_outstanding(arena) == 2);
+  Board *third = AR_take(arena, 0);
+  CU_ASSERT(arena->count == 3 && AR_outstanding(arena) == 3);
+  B_destroy(other);
+  B_destroy(third);
+  CU_ASSERT(AR_outstanding(arena) == 1);
+
+  // Boards not given back outlive the arena and are freed on their own
+  AR_destroy(arena);
+  CU_ASSERT(board->arena == NULL);
+  B_destroy(board);
+  B_destroy(plain);
+}
+
+/** Test that the texture gets a texel per cell, or per square of cells */
+void test_texture(void) {
+  unsigned char cells[5 * 7] = {0};
+  uint32_t pixels[5 * 8];
+  int same = 1;
+
+  cells[0 * 7 + 1] = 1;
+  cells[2 * 7 + 6] = 1;
+  cells[4 * 7 + 3] = 1;
+  // Rows of the texture are 8 texels apart, the last one is never written
+  for (int k = 0; k < 5 * 8; k++)
+    pixels[k] = 0;
+  TX_fill(cells, 5, 7, pixels, 8 * sizeof(uint32_t), 1);
+  for (int i = 0; i < 5; i++) {
+    for (int j = 0; j < 7; j++)
+      same &= pixels[i * 8 + j] ==
+              (cells[i * 7 + j] ? COLOR_ALIVE : COLOR_DEAD);
+    same &= pixels[i * 8 + 7] == 0;
+  }
+  CU_ASSERT(same);
+
+  // With a stride of 2 the 5x7 cells give 3x4 texels, the last row and
+  // column of texels covering a single row or column of cells
+  uint32_t expected[3][4] = {
+      {COLOR_ALIVE, COLOR_DEAD, COLOR_DEAD, COLOR_DEAD},
+      {COLOR_DEAD, COLOR_DEAD, COLOR_DEAD, COLOR_ALIVE},
+      {COLOR_DEAD, COLOR_ALIVE, COLOR_DEAD, COLOR_DEAD}};
+  for (int k = 0; k < 5 * 8; k++)
+    pixels[k] = 0;
+  TX_fill(cells, 5, 7, pixels, 8 * sizeof(uint32_t), 2);
+  same = 1;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 8; j++)
+      same &= pixels[i * 8 + j] == (j < 4 ? expected[i][j] : 0);
+  for (int k = 3 * 8; k < 5 * 8; k++)
+    same &= pixels[k] == 0;
+  CU_ASSERT(same);
+
+  // A stride as large as the board gives one texel, alive if any cell is
+  for (int k = 0; k < 5 * 8; k++)
+    pixels[k] = 0;
+  TX_fill(cells, 5, 7, pixels, 8 * sizeof(uint32_t), 7);
+  CU_ASSERT(pixels[0] == COLOR_ALIVE && pixels[1] == 0 && pixels[8] == 0);
+}
+
+/** Publishes states whose every word is its number, see test_triple */
+static void *triple_producer(void *arg) {
+  TripleBuffer *buffer = (TripleBuffer *)arg;
+  for (unsigned int k = 1; k <= 20000; k++) {
+    unsigned int *state = (unsigned int *)TB_back(buffer);
+    for (int w = 0; w < 256; w++)
+      state[w] = k;
+    TB_publish(buffer);
+  }
+  return NULL;
+}
+
+/** Test that the triple buffer only hands whole states, newest last */
+void test_triple(void) {
+  TripleBuffer *buffer = TB_new(256 * sizeof(unsigned int));
+  pthread_t producer;
+  unsigned int last = 0;
+  int whole = 1, ordered = 1, fresh;
+
+  pthread_create(&producer, NULL, triple_producer, buffer);
+  while (last < 20000) {
+    unsigned int *state = (unsigned int *)TB_acquire(buffer, &fresh);
+    for (int w = 1; w < 256; w++)
+      whole = whole && state[w] == state[0];
+    ordered = ordered && (fresh ? state[0] > last : state[0] == last);
+    last = state[0];
+  }
+  pthread_join(producer, NULL);
+  CU_ASSERT(whole);
+  CU_ASSERT(ordered);
+  TB_acquire(buffer, &fresh);
+  CU_ASSERT_FALSE(fresh);
+  TB_destroy(buffer);
+}
+
+/** Test the half block and braille modes, panning and zooming out */
+void test_frame_modes(void) {
+  Board *board = B_new(8, 8, CLIPPED);
+  Frame *frame = F_new(1, 1, 2);
+  B_set_alive(board, 0, 0);
+  B_set_alive(board, 3, 1);
+
+  // Upper half alive and lower half dead
+  F_set_mode(frame, F_HALF);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "\x1b[47m\x1b[31m\xe2\x96\x80") == 1);
+
+  // Dots 1 and 8 of the braille pattern
+  F_set_mode(frame, F_BRAILLE);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "\xe2\xa2\x81") == 1);
+  CU_ASSERT(F_dots_high(frame) == 4 && F_dots_wide(frame) == 2);
+
+  // Panning away from the alive cells leaves an empty pattern
+  F_set_view(frame, 4, 4, 1);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "\x1b[47m ") == 1);
+
+  // One alive cell out of four is the second shade
+  F_set_mode(frame, F_BLOCK);
+  F_set_view(frame, 0, 0, 2);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "\x1b[48;5;217m  ") == 1);
+
+  F_resize(frame, 4, 4);
+  F_build(frame, board, NULL);
+  CU_ASSERT(frame_count(frame, "  ") == 16);
+
+  F_destroy(frame);
+  B_destroy(board);
 }
 
 int main(int argc, char **argv) {
@@ -161,6 +1274,103 @@ int main(int argc, char **argv) {
     CU_cleanup_registry();
     return CU_get_error();
   }
+  if(CU_add_test(suite1, "Testing if stepping in place works", test_step_in_place) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if packed board works", test_packed) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if SIMD kernels work", test_packed_kernels) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if parallel stepping works", test_parallel) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if large board works", test_large_board) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if HashLife works", test_hashlife) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+
+  if(CU_add_test(suite1, "Testing if HashLife jumps work", test_hashlife_jump) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if activity tracking works", test_activity) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if unbounded board works", test_sparse) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if random generation works", test_generate) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if frame rendering works", test_frame) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if frame modes work", test_frame_modes) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if triple buffer works", test_triple) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if cycle detection works", test_cycle) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if snapshots work", test_snapshot) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if pattern files work", test_pattern) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if rules work", test_rule) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if batches work", test_batch) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if distributed boards work", test_distributed) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if temporal blocking works", test_blocked) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if statistics work", test_stats) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if specialized kernels work", test_kernels) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if board arenas work", test_arena) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
+  if(CU_add_test(suite1, "Testing if texture drawing works", test_texture) == NULL) {
+    CU_cleanup_registry();
+    return CU_get_error();
+  }
   CU_basic_set_mode(CU_BRM_VERBOSE);
   CU_basic_run_tests();  
   CU_cleanup_registry(); 